@@ -0,0 +1,61 @@
+// Throughput of LockFreeStack against EliminationBackoffStack under a 50:50 push/pop mix on one
+// shared stack, 1 to max_threads threads; elimination should keep scaling where the plain stack
+// is stuck on its head. Both run with pooled nodes and with plain new/delete.
+// usage: bench_elimination [max_threads] [ops_per_thread]
+#include "lock_free_stack.hpp"
+#include "elimination_stack.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+template <typename Stack>
+void run(const std::string& name, unsigned n_threads, unsigned ops) {
+  Stack stk;
+  for (int i = 0; i < 1024; i++)
+    stk.push(i);
+
+  std::atomic<unsigned> ready = 0;
+  std::atomic<bool> go = false;
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < n_threads; t++) {
+    threads.push_back(std::thread([&, t](){
+      uint32_t x = 2463534242u + t;
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire));
+      for (unsigned i = 0; i < ops; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        if (x & 1)
+          stk.push(i);
+        else
+          stk.pop();
+      }
+    }));
+  }
+  while (ready.load() != n_threads);
+
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& thr : threads)
+    thr.join();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t total = uint64_t(ops) * n_threads;
+  std::cout << name << "," << n_threads << "," << total << "," << total * 1000.0 / ns << "\n";
+}
+
+int main(int argc, char** argv) {
+  unsigned max_threads = argc > 1 ? std::stoul(argv[1]) : 32;
+  unsigned ops = argc > 2 ? std::stoul(argv[2]) : 400000;
+
+  std::cout << "stack,threads,ops,Mops/s\n";
+  for (unsigned n = 1; n <= max_threads; n *= 2) {
+    run<LockFreeStack<uint64_t>>("treiber", n, ops);
+    run<EliminationBackoffStack<uint64_t>>("elimination", n, ops);
+    run<LockFreeStack<uint64_t, HazardPointers, HeapNodes>>("treiber-heap", n, ops);
+    run<EliminationBackoffStack<uint64_t, HazardPointers, HeapNodes>>("elimination-heap", n, ops);
+  }
+  return 0;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <pthread.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <x86intrin.h>
+#include "contention_stats.hpp"
+
+// Push/pop load on any container with push(uint64_t) and tryPop(uint64_t&); one with tryPush is
+// pushed to with that, so a full bounded queue counts as a failed push instead of blocking.
+// Producers only push, consumers only pop, and the other threads mix both at push_percent.
+// Build with LOCK_FREE_STATS for the CAS counts.
+struct BenchConfig {
+    unsigned producers = 0;
+    unsigned consumers = 0;
+    unsigned threads = 4;
+    // share of pushes among the operations of the mixed threads, the rest are pops
+    unsigned push_percent = 50;
+    uint64_t ops_per_thread = 1000000;
+    // pin thread i to cpu i % hardware_concurrency
+    bool pin = false;
+    size_t prefill = 1024;
+    // time every n-th operation with rdtsc
+    unsigned sample_every = 64;
+
+    unsigned totalThreads() const {
+      return producers + consumers + threads;
+    }
+};
+
+struct BenchResult {
+    double mops = 0;
+    uint64_t ops = 0;
+    // pops that found the container empty and pushes that found it full
+    uint64_t empty_pops = 0;
+    uint64_t full_pushes = 0;
+    double p50_ns = 0;
+    double p99_ns = 0;
+    double p999_ns = 0;
+    double max_ns = 0;
+    uint64_t cas_attempts = 0;
+    uint64_t cas_failures = 0;
+};
+
+inline uint64_t readTsc() {
+  _mm_lfence();
+  uint64_t t = __rdtsc();
+  _mm_lfence();
+  return t;
+}
+
+// rdtsc ticks per nanosecond, measured once against steady_clock
+inline double tscPerNs() {
+  static const double ratio = [](){
+    auto start = std::chrono::steady_clock::now();
+    uint64_t tsc_start = readTsc();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20));
+    uint64_t tsc_end = readTsc();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return double(tsc_end - tsc_start) / ns;
+  }();
+  return ratio;
+}
+
+template <typename C, typename = void>
+struct HasTryPush : std::false_type {};
+
+template <typename C>
+struct HasTryPush<C, std::void_t<decltype(std::declval<C&>().tryPush(uint64_t{}))>> : std::true_type {};
+
+template <typename Container>
+BenchResult runMix(Container& container, const BenchConfig& cfg) {
+  struct PerThread {
+    uint64_t empty_pops = 0;
+    uint64_t full_pushes = 0;
+    CasStats cas;
+    std::vector<uint64_t> samples;
+  };
+
+  if (cfg.sample_every == 0)
+    throw std::invalid_argument("sample_every must be at least 1");
+  if (cfg.totalThreads() == 0)
+    throw std::invalid_argument("no threads to run");
+
+  for (size_t i = 0; i < cfg.prefill; i++)
+    container.push(i);
+
+  const unsigned n_threads = cfg.totalThreads();
+  std::vector<PerThread> results(n_threads);
+  std::atomic<unsigned> ready = 0;
+  std::atomic<bool> go = false;
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < n_threads; t++) {
+    unsigned push_percent = t < cfg.producers ? 100 : t < cfg.producers + cfg.consumers ? 0 : cfg.push_percent;
+    threads.push_back(std::thread([&, t, push_percent](){
+      if (cfg.pin) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(t % std::thread::hardware_concurrency(), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+      }
+      PerThread& r = results[t];
+      r.samples.reserve(cfg.ops_per_thread / cfg.sample_every + 1);
+      uint32_t x = 2463534242u + t;
+      uint64_t v;
+
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire));
+      CasStats before = casStats();
+
+      for (uint64_t i = 0; i < cfg.ops_per_thread; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        bool push = x % 100 < push_percent;
+        bool sampled = i % cfg.sample_every == 0;
+        uint64_t begin = sampled ? readTsc() : 0;
+
+        if (push) {
+          if constexpr (HasTryPush<Container>::value) {
+            if (!container.tryPush(i))
+              r.full_pushes++;
+          }
+          else {
+            container.push(i);
+          }
+        }
+        else if (!container.tryPop(v)) {
+          r.empty_pops++;
+        }
+
+        if (sampled)
+          r.samples.push_back(readTsc() - begin);
+      }
+
+      CasStats after = casStats();
+      r.cas.attempts = after.attempts - before.attempts;
+      r.cas.failures = after.failures - before.failures;
+    }));
+  }
+  while (ready.load() != n_threads);
+
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& thr : threads)
+    thr.join();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  BenchResult res;
+  std::vector<uint64_t> samples;
+  for (auto& r : results) {
+    res.empty_pops += r.empty_pops;
+    res.full_pushes += r.full_pushes;
+    res.cas_attempts += r.cas.attempts;
+    res.cas_failures += r.cas.failures;
+    samples.insert(samples.end(), r.samples.begin(), r.samples.end());
+  }
+  res.ops = cfg.ops_per_thread * n_threads;
+  res.mops = res.ops * 1000.0 / ns;
+
+  if (!samples.empty()) {
+    std::sort(samples.begin(), samples.end());
+    double per_ns = tscPerNs();
+    auto at = [&](double q){
+      return samples[std::min(samples.size() - 1, size_t(q * samples.size()))] / per_ns;
+    };
+    res.p50_ns = at(0.5);
+    res.p99_ns = at(0.99);
+    res.p999_ns = at(0.999);
+    res.max_ns = samples.back() / per_ns;
+  }
+  return res;
+}
+
+inline void printHeader(std::ostream& out) {
+  out << "container,producers,consumers,mixed threads,push %,pinned,ops,Mops/s,empty pops,full pushes,"
+      << "p50 ns,p99 ns,p99.9 ns,max ns,cas attempts,cas failure %\n";
+}
+
+inline void printResult(std::ostream& out, const std::string& name, const BenchConfig& cfg, const BenchResult& res) {
+  double failure_rate = res.cas_attempts ? 100.0 * res.cas_failures / res.cas_attempts : 0;
+  out << name << "," << cfg.producers << "," << cfg.consumers << "," << cfg.threads << ","
+      << cfg.push_percent << "," << cfg.pin << ","
+      << res.ops << "," << res.mops << "," << res.empty_pops << "," << res.full_pushes << ","
+      << res.p50_ns << "," << res.p99_ns << "," << res.p999_ns << "," << res.max_ns << ","
+      << res.cas_attempts << "," << failure_rate << "\n";
+}
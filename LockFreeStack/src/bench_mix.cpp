@@ -0,0 +1,46 @@
+// Mixed push/pop load on one of the containers, or on all of them in turn: throughput, latency
+// percentiles of sampled operations and the CAS failure rate, as CSV.
+// usage: bench_mix [container|all] [threads] [push_percent] [ops_per_thread] [pin 0|1]
+//                  [producers] [consumers] [sample_every]
+// threads mix pushes and pops at push_percent, producers only push and consumers only pop;
+// e.g. the writer/reader pattern of tests.cpp is: bench_mix all 0 0 10000 0 16 15
+// containers: treiber-hp, treiber-epoch, treiber-heap, elimination, ms-queue, bounded-queue
+#include "lock_free_stack.hpp"
+#include "elimination_stack.hpp"
+#include "lock_free_queue.hpp"
+#include "bounded_queue.hpp"
+#include "bench_harness.hpp"
+#include <string>
+
+template <typename Container, typename... Args>
+void bench(const std::string& name, const std::string& which, const BenchConfig& cfg, Args&&... args) {
+  if (which != "all" && which != name)
+    return;
+  Container container(std::forward<Args>(args)...);
+  printResult(std::cout, name, cfg, runMix(container, cfg));
+}
+
+int main(int argc, char** argv) {
+  std::string which = argc > 1 ? argv[1] : "all";
+  BenchConfig cfg;
+  cfg.threads = argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+  cfg.push_percent = argc > 3 ? std::stoul(argv[3]) : 50;
+  cfg.ops_per_thread = argc > 4 ? std::stoull(argv[4]) : 1000000;
+  cfg.pin = argc > 5 && std::stoul(argv[5]) != 0;
+  cfg.producers = argc > 6 ? std::stoul(argv[6]) : 0;
+  cfg.consumers = argc > 7 ? std::stoul(argv[7]) : 0;
+  cfg.sample_every = argc > 8 ? std::stoul(argv[8]) : 64;
+  if (cfg.sample_every == 0 || cfg.totalThreads() == 0) {
+    std::cerr << "sample_every and the number of threads must be at least 1\n";
+    return 1;
+  }
+
+  printHeader(std::cout);
+  bench<LockFreeStack<uint64_t, HazardPointers>>("treiber-hp", which, cfg);
+  bench<LockFreeStack<uint64_t, EpochReclamation>>("treiber-epoch", which, cfg);
+  bench<LockFreeStack<uint64_t, HazardPointers, HeapNodes>>("treiber-heap", which, cfg);
+  bench<EliminationBackoffStack<uint64_t>>("elimination", which, cfg);
+  bench<LockFreeQueue<uint64_t>>("ms-queue", which, cfg);
+  bench<BoundedQueue<uint64_t>>("bounded-queue", which, cfg, 1 << 16);
+  return 0;
+}
@@ -0,0 +1,78 @@
+// Heap allocations per operation and push/pop throughput of LockFreeStack with plain new/delete
+// nodes against pooled ones, 1 to max_threads threads doing push-pop pairs on one shared stack.
+// usage: bench_node_pool [max_threads] [pairs_per_thread]
+#include "lock_free_stack.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// every global allocation of the process, the reclaimers' bookkeeping included
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
+template <typename Alloc>
+void run(const std::string& name, unsigned n_threads, unsigned pairs, bool reserve) {
+  LockFreeStack<uint64_t, HazardPointers, Alloc> stk;
+  if (reserve)
+    stk.reserve(1024 + 256 * n_threads);
+  for (int i = 0; i < 1024; i++)
+    stk.push(i);
+
+  std::atomic<unsigned> ready = 0;
+  std::atomic<bool> go = false;
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < n_threads; t++) {
+    threads.push_back(std::thread([&](){
+      // warm up the thread's reclaimer record outside of the measurement
+      stk.push(0);
+      stk.pop();
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire));
+      for (unsigned i = 0; i < pairs; i++) {
+        stk.push(i);
+        stk.pop();
+      }
+    }));
+  }
+  while (ready.load() != n_threads);
+
+  uint64_t allocs_before = allocations.load();
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& thr : threads)
+    thr.join();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  uint64_t allocs = allocations.load() - allocs_before;
+
+  uint64_t ops = 2ull * pairs * n_threads;
+  std::cout << name << "," << n_threads << "," << ops << "," << double(allocs) / ops << "," << ops * 1000.0 / ns << "\n";
+}
+
+int main(int argc, char** argv) {
+  unsigned max_threads = argc > 1 ? std::stoul(argv[1]) : 32;
+  unsigned pairs = argc > 2 ? std::stoul(argv[2]) : 200000;
+
+  std::cout << "nodes,threads,ops,allocations/op,Mops/s\n";
+  for (unsigned n = 1; n <= max_threads; n *= 2) {
+    run<HeapNodes>("new/delete", n, pairs, false);
+    run<NodePool>("pool", n, pairs, false);
+    run<NodePool>("pool + reserve", n, pairs, true);
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Producer/consumer handoff throughput of the queues against LockFreeStack and a mutex-guarded
+// std::deque: n_threads / 2 producers push items_per_producer items each while the consumers
+// take them out, 2 to max_threads threads.
+// usage: bench_queue [max_threads] [items_per_producer]
+#include "lock_free_stack.hpp"
+#include "lock_free_queue.hpp"
+#include "bounded_queue.hpp"
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MutexDeque {
+    std::mutex m;
+    std::deque<uint64_t> items;
+
+  public:
+    void push(uint64_t value) {
+      std::lock_guard lock(m);
+      items.push_back(value);
+    }
+
+    bool tryPop(uint64_t& result) {
+      std::lock_guard lock(m);
+      if (items.empty())
+        return false;
+      result = items.front();
+      items.pop_front();
+      return true;
+    }
+};
+
+template <typename Container>
+void run(const std::string& name, Container& container, unsigned n_threads, uint64_t items) {
+  unsigned producers = std::max(1u, n_threads / 2);
+  unsigned consumers = std::max(1u, n_threads - producers);
+  std::atomic<uint64_t> consumed = 0;
+  std::atomic<bool> go = false;
+  std::vector<std::thread> threads;
+
+  for (unsigned p = 0; p < producers; p++) {
+    threads.push_back(std::thread([&](){
+      while (!go.load(std::memory_order_acquire));
+      for (uint64_t i = 0; i < items; i++)
+        container.push(i);
+    }));
+  }
+  for (unsigned c = 0; c < consumers; c++) {
+    threads.push_back(std::thread([&](){
+      while (!go.load(std::memory_order_acquire));
+      uint64_t v;
+      while (consumed.load(std::memory_order_relaxed) < producers * items) {
+        if (container.tryPop(v))
+          consumed.fetch_add(1, std::memory_order_relaxed);
+      }
+    }));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& thr : threads)
+    thr.join();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t total = producers * items;
+  std::cout << name << "," << producers << "," << consumers << "," << total << "," << total * 1000.0 / ns << "\n";
+}
+
+int main(int argc, char** argv) {
+  unsigned max_threads = argc > 1 ? std::stoul(argv[1]) : 32;
+  uint64_t items = argc > 2 ? std::stoull(argv[2]) : 200000;
+
+  std::cout << "container,producers,consumers,items,M items/s\n";
+  for (unsigned n = 2; n <= max_threads; n *= 2) {
+    BoundedQueue<uint64_t> bounded(4096);
+    run("bounded queue", bounded, n, items);
+    LockFreeQueue<uint64_t> ms;
+    run("michael-scott queue", ms, n, items);
+    LockFreeStack<uint64_t> stack;
+    run("stack", stack, n, items);
+    MutexDeque deque;
+    run("mutex deque", deque, n, items);
+  }
+  return 0;
+}
@@ -0,0 +1,52 @@
+// Push/pop throughput of LockFreeStack with each reclamation scheme, 1 to max_threads threads,
+// every thread doing push-pop pairs on one shared stack.
+// usage: bench_reclamation [max_threads] [pairs_per_thread]
+#include "lock_free_stack.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+template <typename Reclaimer>
+void run(const std::string& name, unsigned n_threads, unsigned pairs) {
+  LockFreeStack<uint64_t, Reclaimer> stk;
+  // some depth, so pops do not always find the node their own push has just added
+  for (int i = 0; i < 1024; i++)
+    stk.push(i);
+
+  std::atomic<unsigned> ready = 0;
+  std::atomic<bool> go = false;
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < n_threads; t++) {
+    threads.push_back(std::thread([&](){
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire));
+      for (unsigned i = 0; i < pairs; i++) {
+        stk.push(i);
+        stk.pop();
+      }
+    }));
+  }
+  while (ready.load() != n_threads);
+
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& thr : threads)
+    thr.join();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t ops = 2ull * pairs * n_threads;
+  std::cout << name << "," << n_threads << "," << ops << "," << ops * 1000.0 / ns << "\n";
+}
+
+int main(int argc, char** argv) {
+  unsigned max_threads = argc > 1 ? std::stoul(argv[1]) : 32;
+  unsigned pairs = argc > 2 ? std::stoul(argv[2]) : 200000;
+
+  std::cout << "reclaimer,threads,ops,Mops/s\n";
+  for (unsigned n = 1; n <= max_threads; n *= 2) {
+    run<HazardPointers>("hazard pointers", n, pairs);
+    run<EpochReclamation>("epoch", n, pairs);
+  }
+  return 0;
+}
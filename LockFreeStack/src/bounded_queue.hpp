@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include "contention_stats.hpp"
+
+// Bounded MPMC ring (Vyukov). Every cell carries a sequence number that says whose turn it is:
+// equal to the position for the producer of that lap, position + 1 for its consumer. A
+// producer or consumer claims a position with one CAS on its own counter and then only touches
+// its cell, so producers and consumers do not contend with each other. Nodes are not allocated,
+// nothing needs reclaiming.
+template <typename T>
+class BoundedQueue {
+    struct Cell {
+      std::atomic<size_t> sequence;
+      T data;
+    };
+
+    // own cache lines for the two counters and for the read-only fields
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+    alignas(64) std::unique_ptr<Cell[]> buffer;
+    size_t mask;
+
+    static size_t roundUp(size_t n) {
+      size_t p = 2;
+      while (p < n)
+        p <<= 1;
+      return p;
+    }
+
+  public:
+    // capacity is rounded up to a power of two
+    explicit BoundedQueue(size_t capacity) : buffer(new Cell[roundUp(capacity)]), mask(roundUp(capacity) - 1) {
+      for (size_t i = 0; i <= mask; i++)
+        buffer[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const {
+      return mask + 1;
+    }
+
+    // false if the queue is full
+    bool tryPush(T value) {
+      size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+      while (true) {
+        Cell& cell = buffer[pos & mask];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(seq) - intptr_t(pos);
+        if (diff == 0) {
+          if (countCas(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))) {
+            cell.data = std::move(value);
+            cell.sequence.store(pos + 1, std::memory_order_release);
+            return true;
+          }
+        }
+        else if (diff < 0) {
+          // the consumer of the previous lap has not taken this cell yet
+          return false;
+        }
+        else {
+          pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    // false if the queue is empty
+    bool tryPop(T& result) {
+      size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+      while (true) {
+        Cell& cell = buffer[pos & mask];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+        if (diff == 0) {
+          if (countCas(dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))) {
+            result = std::move(cell.data);
+            // free for the producer of the next lap
+            cell.sequence.store(pos + mask + 1, std::memory_order_release);
+            return true;
+          }
+        }
+        else if (diff < 0) {
+          return false;
+        }
+        else {
+          pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    // waits while the queue is full, yielding after a short spin so that an oversubscribed
+    // consumer gets to run
+    void push(T value) {
+      for (unsigned spins = 0; !tryPush(value); spins++) {
+        if (spins < 64)
+          asm volatile ("pause");
+        else
+          std::this_thread::yield();
+      }
+    }
+
+    // T{} if the queue is empty
+    T pop() {
+      T result{};
+      tryPop(result);
+      return result;
+    }
+
+    bool isEmpty() const {
+      size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+      return buffer[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+};
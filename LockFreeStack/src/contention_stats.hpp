@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Per-thread count of the CAS attempts on the contended word of each push and pop (head, tail
+// link, ring counters) and of the ones that failed. Compiled in only with LOCK_FREE_STATS, as
+// the benchmarks do, so the containers pay nothing for it otherwise.
+struct CasStats {
+    uint64_t attempts = 0;
+    uint64_t failures = 0;
+};
+
+inline CasStats& casStats() {
+  thread_local CasStats stats;
+  return stats;
+}
+
+inline bool countCas(bool succeeded) {
+#ifdef LOCK_FREE_STATS
+  CasStats& stats = casStats();
+  stats.attempts++;
+  stats.failures += !succeeded;
+#endif
+  return succeeded;
+}
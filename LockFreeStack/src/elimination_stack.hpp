@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "lock_free_stack.hpp"
+
+// Elimination array for EliminationBackoffStack (Hendler, Shavit, Yerushalmi, 2004). A push and
+// a pop that meet in the same slot cancel out: the pop takes the pushed node and neither of them
+// touches the stack. A slot holds nullptr, a push waiting with its node, a pop waiting, a node
+// delivered to the waiting pop (pointer | DELIVERED) or the marker of a claimed push; whoever put
+// a waiter there clears the slot again. Pairing only hands over nodes that were never in the
+// stack, so they need no reclamation.
+template <typename T, typename Alloc = NodePool>
+class EliminationArray {
+    using Node = ::Node<T, Alloc>;
+
+  public:
+    static constexpr unsigned CAPACITY = 16;
+    // pause rounds a visitor waits for a partner
+    static constexpr unsigned PATIENCE = 128;
+
+  private:
+    static constexpr uintptr_t DELIVERED = 1;
+
+    struct alignas(64) Slot {
+      std::atomic<uintptr_t> state{0};
+    };
+
+    // markers carry the DELIVERED bit, so neither kind of visitor mistakes them for a waiting push
+    alignas(8) static inline char waiting_pop_tag, taken_tag;
+
+    static uintptr_t waitingPop() {
+      return reinterpret_cast<uintptr_t>(&waiting_pop_tag) | DELIVERED;
+    }
+
+    static uintptr_t taken() {
+      return reinterpret_cast<uintptr_t>(&taken_tag) | DELIVERED;
+    }
+
+    // the first width slots are in use: grows when visitors find slots busy, shrinks when they
+    // wait in vain, so a few threads still meet and many do not crowd one slot
+    std::atomic<unsigned> width{1};
+    Slot slots[CAPACITY];
+
+    static uint32_t random() {
+      thread_local uint32_t x = 0x9e3779b9u ^ static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&x));
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      return x;
+    }
+
+    Slot& pick() {
+      return slots[random() % width.load(std::memory_order_relaxed)];
+    }
+
+    void busy() {
+      unsigned w = width.load(std::memory_order_relaxed);
+      if (w < CAPACITY)
+        width.compare_exchange_weak(w, w + 1, std::memory_order_relaxed);
+    }
+
+    void lonely() {
+      unsigned w = width.load(std::memory_order_relaxed);
+      if (w > 1)
+        width.compare_exchange_weak(w, w - 1, std::memory_order_relaxed);
+    }
+
+  public:
+    // true if a pop took the node
+    bool tryPush(Node* node) {
+      Slot& slot = pick();
+      uintptr_t mine = reinterpret_cast<uintptr_t>(node);
+      uintptr_t seen = 0;
+      if (slot.state.compare_exchange_strong(seen, mine, std::memory_order_release, std::memory_order_relaxed)) {
+        for (unsigned i = 0; i < PATIENCE; i++) {
+          if (slot.state.load(std::memory_order_acquire) != mine)
+            break;
+          asm volatile ("pause");
+        }
+        if (slot.state.compare_exchange_strong(mine, 0, std::memory_order_acquire, std::memory_order_acquire)) {
+          lonely();
+          return false;
+        }
+        // a pop has swapped in taken() to claim the node
+        slot.state.store(0, std::memory_order_release);
+        return true;
+      }
+      if (seen == waitingPop()
+          && slot.state.compare_exchange_strong(seen, mine | DELIVERED, std::memory_order_release, std::memory_order_relaxed))
+        return true;
+      busy();
+      return false;
+    }
+
+    // the pushed node taken over from a push, nullptr if no partner came
+    Node* tryPop() {
+      Slot& slot = pick();
+      uintptr_t seen = slot.state.load(std::memory_order_acquire);
+      if (seen == 0) {
+        if (!slot.state.compare_exchange_strong(seen, waitingPop(), std::memory_order_acquire, std::memory_order_acquire)) {
+          busy();
+          return nullptr;
+        }
+        for (unsigned i = 0; i < PATIENCE; i++) {
+          if (slot.state.load(std::memory_order_acquire) != waitingPop())
+            break;
+          asm volatile ("pause");
+        }
+        uintptr_t expected = waitingPop();
+        if (slot.state.compare_exchange_strong(expected, 0, std::memory_order_acquire, std::memory_order_acquire)) {
+          lonely();
+          return nullptr;
+        }
+        slot.state.store(0, std::memory_order_relaxed);
+        return reinterpret_cast<Node*>(expected & ~DELIVERED);
+      }
+      // a waiting push: claim its node, the push clears the slot
+      if (!(seen & DELIVERED)
+          && slot.state.compare_exchange_strong(seen, taken(), std::memory_order_acquire, std::memory_order_relaxed))
+        return reinterpret_cast<Node*>(seen);
+      busy();
+      return nullptr;
+    }
+};
+
+// Treiber stack that backs off into an EliminationArray after a failed CAS on head, so under
+// contention pushes and pops pair up in the array instead of all retrying on one cache line.
+// Same interface, reclamation and node allocation as LockFreeStack.
+template <typename T, typename Reclaimer = HazardPointers, typename Alloc = NodePool>
+class EliminationBackoffStack {
+    using Node = ::Node<T, Alloc>;
+
+    std::atomic<Node*> head{nullptr};
+    EliminationArray<T, Alloc> elimination;
+
+  public:
+    EliminationBackoffStack() = default;
+
+    ~EliminationBackoffStack() {
+      Node* node = head.load(std::memory_order_relaxed);
+      while (node) {
+        Node* next = node->next;
+        delete node;
+        node = next;
+      }
+    }
+
+    void reserve(size_t n) {
+      Alloc::template reserve<sizeof(Node)>(n);
+    }
+
+    void push(T value) {
+      Node* newNode = new Node(value);
+      newNode->next = head.load(std::memory_order_relaxed);
+
+      while (!countCas(head.compare_exchange_weak(
+                newNode->next,
+                newNode,
+                std::memory_order_release,
+                std::memory_order_relaxed))) {
+        if (elimination.tryPush(newNode))
+          return;
+        newNode->next = head.load(std::memory_order_relaxed);
+      }
+    }
+
+    bool tryPop(T& result) {
+      while (true) {
+        {
+          typename Reclaimer::Guard guard;
+          Node* oldHead = guard.protect(0, head);
+          if (!oldHead)
+            return false;
+
+          if (countCas(head.compare_exchange_weak(
+                oldHead,
+                oldHead->next,
+                std::memory_order_acquire,
+                std::memory_order_relaxed))) {
+            result = std::move(oldHead->data);
+            Reclaimer::retire(oldHead);
+            return true;
+          }
+        }
+
+        // no guard while waiting in the array, epochs keep advancing
+        if (Node* node = elimination.tryPop()) {
+          result = std::move(node->data);
+          delete node;
+          return true;
+        }
+      }
+    }
+
+    // T{} if the stack is empty
+    T pop() {
+      T result{};
+      tryPop(result);
+      return result;
+    }
+
+    bool isEmpty() const {
+        return head.load(std::memory_order_relaxed) == nullptr;
+    }
+};
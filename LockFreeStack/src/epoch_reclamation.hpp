@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Epoch-based reclamation (Fraser, 2004): an operation only announces the global epoch it runs
+// in, and the epoch advances once every running operation has seen the current one. A node
+// retired in epoch e cannot be reached by anybody after the epoch reaches e + 2. Loads cost
+// nothing extra, but one stalled thread stops all reclamation.
+//
+// Same interface as HazardPointers; guards may nest, `protect` ignores its slot.
+class EpochReclamation {
+    struct Retired {
+      void* ptr;
+      void (*destroy)(void*);
+    };
+
+    static constexpr uint64_t ACTIVE = 1;
+    // retires between attempts to advance the epoch
+    static constexpr size_t ADVANCE_EVERY = 64;
+
+    struct Record {
+      // (epoch << 1) | ACTIVE while inside a guard, 0 outside
+      std::atomic<uint64_t> announced{0};
+      std::atomic<bool> in_use{true};
+      Record* next = nullptr;
+      // touched only by the owner: nesting depth and the nodes retired in each of the last 3 epochs
+      unsigned depth = 0;
+      size_t since_advance = 0;
+      std::vector<Retired> bags[3];
+      uint64_t bag_epoch[3] = {};
+    };
+
+    struct Domain {
+      std::atomic<uint64_t> epoch{0};
+      std::atomic<Record*> records{nullptr};
+
+      Record* acquire() {
+        for (Record* r = records.load(std::memory_order_acquire); r; r = r->next) {
+          if (!r->in_use.load(std::memory_order_relaxed) && !r->in_use.exchange(true, std::memory_order_acquire))
+            return r;
+        }
+        Record* r = new Record;
+        r->next = records.load(std::memory_order_relaxed);
+        while (!records.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed));
+        return r;
+      }
+
+      void tryAdvance() {
+        uint64_t e = epoch.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (Record* r = records.load(std::memory_order_acquire); r; r = r->next) {
+          uint64_t a = r->announced.load(std::memory_order_relaxed);
+          if ((a & ACTIVE) && (a >> 1) != e)
+            return;
+        }
+        epoch.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel, std::memory_order_relaxed);
+      }
+
+      ~Domain() {
+        Record* r = records.load(std::memory_order_acquire);
+        while (r) {
+          for (auto& bag : r->bags) {
+            for (auto& node : bag)
+              node.destroy(node.ptr);
+          }
+          Record* next = r->next;
+          delete r;
+          r = next;
+        }
+      }
+    };
+
+    static Domain& domain() {
+      static Domain d;
+      return d;
+    }
+
+    struct Owner {
+      Record* rec = domain().acquire();
+
+      ~Owner() {
+        rec->announced.store(0, std::memory_order_release);
+        rec->in_use.store(false, std::memory_order_release);
+      }
+    };
+
+    static Record& local() {
+      thread_local Owner owner;
+      return *owner.rec;
+    }
+
+    static void free(std::vector<Retired>& bag) {
+      for (auto& node : bag)
+        node.destroy(node.ptr);
+      bag.clear();
+    }
+
+  public:
+    class Guard {
+        Record& rec = local();
+
+      public:
+        Guard() {
+          if (rec.depth++ == 0) {
+            rec.announced.store((domain().epoch.load(std::memory_order_relaxed) << 1) | ACTIVE, std::memory_order_relaxed);
+            // the announcement must be visible before any shared pointer is read
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+          }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+          if (--rec.depth == 0)
+            rec.announced.store(0, std::memory_order_release);
+        }
+
+        template <typename P>
+        P* protect(size_t, const std::atomic<P*>& src) {
+          return src.load(std::memory_order_acquire);
+        }
+    };
+
+    template <typename P>
+    static void retire(P* p) {
+      Record& rec = local();
+      uint64_t e = domain().epoch.load(std::memory_order_acquire);
+      size_t i = e % 3;
+      // the bag was filled in epoch e - 3 or earlier, nobody can reach those nodes any more
+      if (rec.bag_epoch[i] != e) {
+        free(rec.bags[i]);
+        rec.bag_epoch[i] = e;
+      }
+      rec.bags[i].push_back({p, [](void* q){ delete static_cast<P*>(q); }});
+      if (++rec.since_advance >= ADVANCE_EVERY) {
+        rec.since_advance = 0;
+        domain().tryAdvance();
+      }
+    }
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Hazard pointers (Michael, 2004): before dereferencing a shared node a thread publishes its
+// address in one of its hazard slots, and a retired node is deleted only once no slot holds it.
+// Bounded garbage and no dependence on other threads making progress, at the cost of a store
+// and a fence for every protected load.
+//
+// Reclaimer interface shared with EpochReclamation, used by LockFreeStack and the queues:
+//   Reclaimer::Guard g;              - one per operation, not nested
+//   g.protect(i, src)                - loads src, the result stays valid while g lives
+//   Reclaimer::retire(p)             - deletes p once no guard can reach it
+class HazardPointers {
+  public:
+    // slots per thread, the Michael-Scott queue needs two
+    static constexpr size_t SLOTS = 2;
+
+  private:
+    struct Retired {
+      void* ptr;
+      void (*destroy)(void*);
+    };
+
+    struct Record {
+      std::atomic<void*> hazard[SLOTS] = {};
+      std::atomic<bool> in_use{true};
+      Record* next = nullptr;
+      // touched only by the thread that owns the record
+      std::vector<Retired> retired;
+      std::vector<void*> hazards;
+    };
+
+    // records are never freed while the program runs, a thread that exits hands its record
+    // (together with the nodes it could not free yet) to the next thread
+    struct Domain {
+      std::atomic<Record*> records{nullptr};
+      std::atomic<size_t> count{0};
+
+      Record* acquire() {
+        for (Record* r = records.load(std::memory_order_acquire); r; r = r->next) {
+          if (!r->in_use.load(std::memory_order_relaxed) && !r->in_use.exchange(true, std::memory_order_acquire))
+            return r;
+        }
+        Record* r = new Record;
+        r->next = records.load(std::memory_order_relaxed);
+        while (!records.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed));
+        count.fetch_add(1, std::memory_order_relaxed);
+        return r;
+      }
+
+      ~Domain() {
+        Record* r = records.load(std::memory_order_acquire);
+        while (r) {
+          for (auto& node : r->retired)
+            node.destroy(node.ptr);
+          Record* next = r->next;
+          delete r;
+          r = next;
+        }
+      }
+    };
+
+    static Domain& domain() {
+      static Domain d;
+      return d;
+    }
+
+    struct Owner {
+      Record* rec = domain().acquire();
+
+      ~Owner() {
+        for (auto& h : rec->hazard)
+          h.store(nullptr, std::memory_order_relaxed);
+        rec->in_use.store(false, std::memory_order_release);
+      }
+    };
+
+    static Record& local() {
+      thread_local Owner owner;
+      return *owner.rec;
+    }
+
+    // deletes every retired node of this thread that no slot protects
+    static void scan(Record& rec) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto& hazards = rec.hazards;
+      hazards.clear();
+      for (Record* r = domain().records.load(std::memory_order_acquire); r; r = r->next) {
+        for (auto& h : r->hazard) {
+          if (void* p = h.load(std::memory_order_acquire))
+            hazards.push_back(p);
+        }
+      }
+      std::sort(hazards.begin(), hazards.end());
+
+      auto still_used = std::partition(rec.retired.begin(), rec.retired.end(), [&](const Retired& node){
+        return std::binary_search(hazards.begin(), hazards.end(), node.ptr);
+      });
+      for (auto it = still_used; it != rec.retired.end(); ++it)
+        it->destroy(it->ptr);
+      rec.retired.erase(still_used, rec.retired.end());
+    }
+
+  public:
+    class Guard {
+        Record& rec = local();
+
+      public:
+        Guard() = default;
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+          for (auto& h : rec.hazard)
+            h.store(nullptr, std::memory_order_release);
+        }
+
+        template <typename P>
+        P* protect(size_t slot, const std::atomic<P*>& src) {
+          P* p = src.load(std::memory_order_relaxed);
+          while (true) {
+            rec.hazard[slot].store(p, std::memory_order_relaxed);
+            // the slot must be visible to scanners before src is read again
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            P* again = src.load(std::memory_order_acquire);
+            if (again == p)
+              return p;
+            p = again;
+          }
+        }
+    };
+
+    template <typename P>
+    static void retire(P* p) {
+      Record& rec = local();
+      rec.retired.push_back({p, [](void* q){ delete static_cast<P*>(q); }});
+      // amortized O(1): at least half of a batch this size is free to delete
+      if (rec.retired.size() >= 2 * SLOTS * domain().count.load(std::memory_order_relaxed) + 64)
+        scan(rec);
+    }
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include "hazard_pointers.hpp"
+#include "epoch_reclamation.hpp"
+#include "node_pool.hpp"
+#include "contention_stats.hpp"
+
+template <typename T, typename Alloc = NodePool>
+struct QueueNode {
+    T data;
+    std::atomic<QueueNode*> next{nullptr};
+
+    QueueNode(T val) : data(std::move(val)) {}
+
+    static void* operator new(size_t) {
+      return Alloc::template allocate<sizeof(QueueNode)>();
+    }
+
+    static void operator delete(void* p) {
+      Alloc::template deallocate<sizeof(QueueNode)>(p);
+    }
+};
+
+// Unbounded MPMC queue (Michael, Scott, 1996). head points to a dummy node whose successor is
+// the front, push links behind the last node and then swings tail, and any thread that finds
+// tail lagging swings it on. A dequeued dummy goes to Reclaimer like a popped node of
+// LockFreeStack; a pop protects the dummy and its successor, a push the last node.
+template <typename T, typename Reclaimer = HazardPointers, typename Alloc = NodePool>
+class LockFreeQueue {
+    using Node = QueueNode<T, Alloc>;
+
+    alignas(64) std::atomic<Node*> head;
+    alignas(64) std::atomic<Node*> tail;
+
+  public:
+    LockFreeQueue() {
+      Node* dummy = new Node(T{});
+      head.store(dummy, std::memory_order_relaxed);
+      tail.store(dummy, std::memory_order_relaxed);
+    }
+
+    ~LockFreeQueue() {
+      Node* node = head.load(std::memory_order_relaxed);
+      while (node) {
+        Node* next = node->next.load(std::memory_order_relaxed);
+        delete node;
+        node = next;
+      }
+    }
+
+    void reserve(size_t n) {
+      Alloc::template reserve<sizeof(Node)>(n);
+    }
+
+    void push(T value) {
+      Node* newNode = new Node(std::move(value));
+      typename Reclaimer::Guard guard;
+
+      while (true) {
+        Node* last = guard.protect(0, tail);
+        Node* next = last->next.load(std::memory_order_acquire);
+        if (last != tail.load(std::memory_order_acquire))
+          continue;
+        if (next) {
+          tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+          continue;
+        }
+        if (countCas(last->next.compare_exchange_weak(next, newNode, std::memory_order_release, std::memory_order_relaxed))) {
+          tail.compare_exchange_strong(last, newNode, std::memory_order_release, std::memory_order_relaxed);
+          return;
+        }
+      }
+    }
+
+    bool tryPop(T& result) {
+      typename Reclaimer::Guard guard;
+
+      while (true) {
+        Node* first = guard.protect(0, head);
+        Node* last = tail.load(std::memory_order_acquire);
+        Node* next = guard.protect(1, first->next);
+        // next is only safe to use while first is still the dummy
+        if (first != head.load(std::memory_order_acquire))
+          continue;
+        if (!next)
+          return false;
+        if (first == last) {
+          tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+          continue;
+        }
+        if (countCas(head.compare_exchange_weak(first, next, std::memory_order_acquire, std::memory_order_relaxed))) {
+          // next is the new dummy, its data belongs to whoever made it one
+          result = std::move(next->data);
+          Reclaimer::retire(first);
+          return true;
+        }
+      }
+    }
+
+    // T{} if the queue is empty
+    T pop() {
+      T result{};
+      tryPop(result);
+      return result;
+    }
+
+    bool isEmpty() const {
+      typename Reclaimer::Guard guard;
+      return guard.protect(0, head)->next.load(std::memory_order_acquire) == nullptr;
+    }
+};
@@ -1,73 +1,135 @@
+#pragma once
+
 #include <atomic>
 #include <iostream>
 #include <memory>
+#include <utility>
+#include "hazard_pointers.hpp"
+#include "epoch_reclamation.hpp"
+#include "node_pool.hpp"
+#include "contention_stats.hpp"
 
-template <typename T>
+template <typename T, typename Alloc = NodePool>
 struct Node {
     T data;
     Node* next;
 
     Node(T val) : data(val), next(nullptr) {}
-};
 
-template <typename T>
-struct TaggedPointer {
-    Node<T>* ptr;
-    uintptr_t tag;
+    static void* operator new(size_t) {
+      return Alloc::template allocate<sizeof(Node)>();
+    }
 
-    TaggedPointer(Node<T>* p = nullptr, uintptr_t t = 0) : ptr(p), tag(t) {}
+    static void operator delete(void* p) {
+      Alloc::template deallocate<sizeof(Node)>(p);
+    }
 };
 
-template <typename T>
+// Treiber stack. A popped node is handed to Reclaimer (HazardPointers or EpochReclamation)
+// instead of being deleted, so a concurrent pop that still reads its `next` never touches freed
+// memory, and the node cannot come back to the head while such a pop is about to CAS, which
+// takes care of ABA without a tag next to the pointer. Nodes come from Alloc, NodePool unless
+// HeapNodes is asked for.
+template <typename T, typename Reclaimer = HazardPointers, typename Alloc = NodePool>
 class LockFreeStack {
-    std::atomic<TaggedPointer<T>> head;
+    using Node = ::Node<T, Alloc>;
+
+    std::atomic<Node*> head{nullptr};
 
   public:
-    LockFreeStack() : head(TaggedPointer<T>()) {}
+    LockFreeStack() = default;
 
+    // nobody else may use the stack any more, so the nodes go straight to delete
     ~LockFreeStack() {
-      while (pop());
+      Node* node = head.load(std::memory_order_relaxed);
+      while (node) {
+        Node* next = node->next;
+        delete node;
+        node = next;
+      }
+    }
+
+    // pre-warms the node pool with room for n nodes
+    void reserve(size_t n) {
+      Alloc::template reserve<sizeof(Node)>(n);
     }
 
     void push(T value) {
-      Node<T>* newNode = new Node<T>(value);
-      TaggedPointer<T> oldHead = head.load(std::memory_order_relaxed);
+      Node* newNode = new Node(value);
+      newNode->next = head.load(std::memory_order_relaxed);
+
+      while (!countCas(head.compare_exchange_weak(
+                newNode->next,
+                newNode,
+                std::memory_order_release,
+                std::memory_order_relaxed))) {
+      }
+    }
+
+    // pushes [first, last) with a single CAS; *first ends up deepest, as with one push per item
+    template <typename InputIt>
+    void pushRange(InputIt first, InputIt last) {
+      if (first == last)
+        return;
+      Node* bottom = new Node(*first);
+      Node* top = bottom;
+      for (++first; first != last; ++first) {
+        Node* node = new Node(*first);
+        node->next = top;
+        top = node;
+      }
+      bottom->next = head.load(std::memory_order_relaxed);
+
+      while (!countCas(head.compare_exchange_weak(
+                bottom->next,
+                top,
+                std::memory_order_release,
+                std::memory_order_relaxed))) {
+      }
+    }
+
+    bool tryPop(T& result) {
+      typename Reclaimer::Guard guard;
 
       while (true) {
-        newNode->next = oldHead.ptr; 
-        TaggedPointer<T> newHead(newNode, oldHead.tag + 1);
-
-        if (head.compare_exchange_weak(
-              oldHead, 
-              newHead,
-              std::memory_order_release,
-              std::memory_order_relaxed)) {
-          break;
+        Node* oldHead = guard.protect(0, head);
+        if (!oldHead)
+          return false;
+
+        if (countCas(head.compare_exchange_weak(
+              oldHead,
+              oldHead->next,
+              std::memory_order_acquire,
+              std::memory_order_relaxed))) {
+          result = std::move(oldHead->data);
+          Reclaimer::retire(oldHead);
+          return true;
         }
       }
     }
 
+    // T{} if the stack is empty
     T pop() {
-      TaggedPointer<T> oldHead = head.load(std::memory_order_relaxed);
-
-      while (oldHead.ptr) {
-        TaggedPointer<T> newHead(oldHead.ptr->next, oldHead.tag + 1);
-
-        if (head.compare_exchange_weak( 
-              oldHead, 
-              newHead, 
-              std::memory_order_acquire, 
-              std::memory_order_relaxed)) {
-          T result = oldHead.ptr->data;
-          delete oldHead.ptr;
-          return result;
-        }
-      }
+      T result{};
+      tryPop(result);
+      return result;
+    }
 
-      return {};
+    // takes the whole stack with one exchange and writes it to out, top first
+    template <typename OutputIt>
+    OutputIt popAll(OutputIt out) {
+      Node* node = head.exchange(nullptr, std::memory_order_acquire);
+      while (node) {
+        *out++ = std::move(node->data);
+        Node* next = node->next;
+        // a pop that read the node while it was on top may still hold it
+        Reclaimer::retire(node);
+        node = next;
+      }
+      return out;
     }
 
     bool isEmpty() const {
-        return head.load(std::memory_order_relaxed).ptr == nullptr;
+        return head.load(std::memory_order_relaxed) == nullptr;
     }
 };
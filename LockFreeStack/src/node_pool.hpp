@@ -0,0 +1,205 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Fixed size blocks for the nodes of the stacks and queues, recycled instead of going back to
+// the global allocator. Every thread keeps up to 2 * BATCH free blocks of its own; beyond that it
+// hands BATCH of them at once to a shared lock-free list of batches, and takes a whole batch
+// from there (or carves a new chunk) when it runs dry. Chunks are never freed, so the pool
+// holds at most the peak number of live nodes plus the per-thread caches.
+template <size_t Size>
+class NodeBlocks {
+  public:
+    static constexpr size_t BATCH = 64;
+
+  private:
+    struct FreeBlock {
+      FreeBlock* next;
+      // meaningful in the first block of a batch only
+      std::atomic<FreeBlock*> next_batch;
+      size_t count;
+    };
+
+    static constexpr size_t ALIGN = alignof(std::max_align_t);
+    static constexpr size_t BLOCK = ((Size > sizeof(FreeBlock) ? Size : sizeof(FreeBlock)) + ALIGN - 1) / ALIGN * ALIGN;
+
+    struct alignas(ALIGN) Chunk {
+      Chunk* next;
+    };
+
+    // trivially destructible, so it stays usable while the thread's destructors run
+    struct Cache {
+      FreeBlock* list;
+      size_t count;
+      bool retired;
+    };
+
+    struct Flusher {
+      ~Flusher() {
+        Cache& c = cache;
+        if (c.list) {
+          c.list->count = c.count;
+          pushBatch(c.list);
+        }
+        c = {nullptr, 0, true};
+      }
+    };
+
+    static inline thread_local Cache cache = {nullptr, 0, false};
+    // the head of the batch list with a 16 bit version in the top bits against ABA,
+    // one word so the CAS is lock-free everywhere
+    static inline std::atomic<uint64_t> shared{0};
+    // blocks in the batches on the shared list; for reserve, so it may lag behind for a moment
+    static inline std::atomic<int64_t> shared_blocks{0};
+    // keeps the chunks reachable for leak checkers
+    static inline std::atomic<Chunk*> chunks{nullptr};
+
+    static constexpr int TAG_SHIFT = 48;
+    static constexpr uint64_t PTR_MASK = (uint64_t(1) << TAG_SHIFT) - 1;
+
+    static FreeBlock* unpack(uint64_t word) {
+      return reinterpret_cast<FreeBlock*>(word & PTR_MASK);
+    }
+
+    static uint64_t pack(FreeBlock* b, uint64_t prev) {
+      return reinterpret_cast<uint64_t>(b) | (((prev >> TAG_SHIFT) + 1) << TAG_SHIFT);
+    }
+
+    static void pushBatch(FreeBlock* b) {
+      // b belongs to whoever pops it once it is on the list
+      size_t count = b->count;
+      uint64_t old = shared.load(std::memory_order_relaxed);
+      do {
+        b->next_batch.store(unpack(old), std::memory_order_relaxed);
+      } while (!shared.compare_exchange_weak(old, pack(b, old), std::memory_order_release, std::memory_order_relaxed));
+      shared_blocks.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    static FreeBlock* popBatch() {
+      uint64_t old = shared.load(std::memory_order_acquire);
+      while (FreeBlock* b = unpack(old)) {
+        // b may be taken and reused meanwhile, but its memory stays a block of this pool and
+        // the version makes the CAS fail then
+        FreeBlock* next = b->next_batch.load(std::memory_order_relaxed);
+        if (shared.compare_exchange_weak(old, pack(next, old), std::memory_order_acquire, std::memory_order_acquire)) {
+          shared_blocks.fetch_sub(b->count, std::memory_order_relaxed);
+          return b;
+        }
+      }
+      return nullptr;
+    }
+
+    static FreeBlock* newChunk() {
+      void* mem = ::operator new(sizeof(Chunk) + BATCH * BLOCK);
+      Chunk* chunk = new (mem) Chunk;
+      chunk->next = chunks.load(std::memory_order_relaxed);
+      while (!chunks.compare_exchange_weak(chunk->next, chunk, std::memory_order_release, std::memory_order_relaxed));
+
+      char* first = static_cast<char*>(mem) + sizeof(Chunk);
+      FreeBlock* next = nullptr;
+      for (size_t i = BATCH; i-- > 0;) {
+        FreeBlock* b = new (first + i * BLOCK) FreeBlock;
+        b->next = next;
+        next = b;
+      }
+      next->count = BATCH;
+      return next;
+    }
+
+    static Cache& local() {
+      static thread_local Flusher flusher;
+      (void)flusher;
+      return cache;
+    }
+
+  public:
+    static void* allocate() {
+      Cache& c = cache.retired ? cache : local();
+      if (!c.list) {
+        FreeBlock* batch = popBatch();
+        if (!batch)
+          batch = newChunk();
+        c.list = batch;
+        c.count = batch->count;
+      }
+      FreeBlock* b = c.list;
+      c.list = b->next;
+      c.count--;
+      return b;
+    }
+
+    static void deallocate(void* p) {
+      FreeBlock* b = new (p) FreeBlock;
+      if (cache.retired) {
+        b->next = nullptr;
+        b->count = 1;
+        pushBatch(b);
+        return;
+      }
+      Cache& c = local();
+      b->next = c.list;
+      c.list = b;
+      if (++c.count < 2 * BATCH)
+        return;
+
+      // keep the most recently freed half, which is still warm in the cache
+      FreeBlock* last = c.list;
+      for (size_t i = 1; i < BATCH; i++)
+        last = last->next;
+      FreeBlock* batch = last->next;
+      last->next = nullptr;
+      batch->count = c.count - BATCH;
+      c.count = BATCH;
+      pushBatch(batch);
+    }
+
+    // free blocks on the shared list and in the calling thread's cache
+    static size_t available() {
+      int64_t on_list = shared_blocks.load(std::memory_order_relaxed);
+      return (on_list > 0 ? size_t(on_list) : 0) + cache.count;
+    }
+
+    // tops the free blocks up to n, carving only the shortfall; blocks cached by other threads
+    // are not counted, and concurrent calls may both carve
+    static void reserve(size_t n) {
+      for (size_t have = available(); have < n; have += BATCH)
+        pushBatch(newChunk());
+    }
+};
+
+// Allocation policy of Node: blocks from NodeBlocks.
+struct NodePool {
+  template <size_t Size>
+  static void* allocate() {
+    return NodeBlocks<Size>::allocate();
+  }
+
+  template <size_t Size>
+  static void deallocate(void* p) {
+    NodeBlocks<Size>::deallocate(p);
+  }
+
+  template <size_t Size>
+  static void reserve(size_t n) {
+    NodeBlocks<Size>::reserve(n);
+  }
+};
+
+// Allocation policy of Node: plain new and delete.
+struct HeapNodes {
+  template <size_t Size>
+  static void* allocate() {
+    return ::operator new(Size);
+  }
+
+  template <size_t Size>
+  static void deallocate(void* p) {
+    ::operator delete(p);
+  }
+
+  template <size_t Size>
+  static void reserve(size_t) {}
+};
@@ -1,13 +1,18 @@
 #include "lock_free_stack.hpp"
+#include "elimination_stack.hpp"
+#include "lock_free_queue.hpp"
+#include "bounded_queue.hpp"
 #include <thread>
 #include <vector>
 #include <chrono>
+#include <iterator>
 #include <assert.h>
 
-int main() {
+template <typename Stack>
+void writeThenRead() {
   using namespace std::chrono_literals;
 
-  LockFreeStack<int> stk;
+  Stack stk;
   // stk.push(1);
 
   std::vector<std::thread> threads;
@@ -46,6 +51,180 @@ int main() {
 
   std::cout << "readed: " << count_readed << ", written: " << count_written << "\n";
   assert(count_readed == count_written);
-    
+}
+
+// pushes and pops at the same time, so pops race with the reuse of the nodes they read
+template <typename Stack>
+void mixed() {
+  Stack stk;
+  std::vector<std::thread> threads;
+  std::atomic<uint64_t> sum_pushed = 0;
+  std::atomic<uint64_t> sum_popped = 0;
+
+  for (int t = 0; t < 8; t++) {
+    threads.push_back(std::thread([&, t](){
+      uint64_t pushed = 0, popped = 0;
+      for (int i = 0; i < 20000; i++) {
+        int val = t * 20000 + i + 1;
+        stk.push(val);
+        pushed += val;
+        popped += stk.pop();
+      }
+      sum_pushed.fetch_add(pushed);
+      sum_popped.fetch_add(popped);
+    }));
+  }
+  for (auto& thr : threads)
+    thr.join();
+
+  std::cout << "mixed pushed: " << sum_pushed << ", popped: " << sum_popped << "\n";
+  // every pop follows a push of the same thread, so none of them finds the stack empty
+  assert(sum_popped == sum_pushed);
+  assert(stk.isEmpty());
+}
+
+// batches in with pushRange, out with popAll and tryPop while producers are still running;
+// values include 0, which tryPop tells apart from an empty stack
+void bulk() {
+  LockFreeStack<int> stk;
+  std::vector<std::thread> threads;
+  std::atomic<int> producing = 4;
+  std::atomic<uint64_t> count_readed = 0;
+  std::atomic<uint64_t> sum_readed = 0;
+
+  for (int t = 0; t < 4; t++) {
+    threads.push_back(std::thread([&](){
+      std::vector<int> batch(100);
+      for (int round = 0; round < 500; round++) {
+        for (int i = 0; i < 100; i++)
+          batch[i] = i;
+        stk.pushRange(batch.begin(), batch.end());
+      }
+      producing--;
+    }));
+  }
+  for (int t = 0; t < 4; t++) {
+    threads.push_back(std::thread([&, t](){
+      std::vector<int> out;
+      uint64_t count = 0, sum = 0;
+      while (producing != 0 || !stk.isEmpty()) {
+        if (t % 2) {
+          out.clear();
+          stk.popAll(std::back_inserter(out));
+          for (int v : out) {
+            count++;
+            sum += v;
+          }
+        }
+        else {
+          int v;
+          if (stk.tryPop(v)) {
+            count++;
+            sum += v;
+          }
+        }
+      }
+      count_readed += count;
+      sum_readed += sum;
+    }));
+  }
+  for (auto& thr : threads)
+    thr.join();
+
+  std::cout << "bulk readed: " << count_readed << ", sum: " << sum_readed << "\n";
+  assert(count_readed == 4 * 500 * 100);
+  assert(sum_readed == 4 * 500 * (99 * 100 / 2));
+
+  int v = 1;
+  assert(!stk.tryPop(v) && v == 1);
+  int items[] = {1, 2, 3};
+  stk.pushRange(items, items + 3);
+  std::vector<int> out;
+  stk.popAll(std::back_inserter(out));
+  assert((out == std::vector<int>{3, 2, 1}));
+}
+
+// reserve tops the pool up instead of adding to it, and reserved blocks serve the pushes
+void reserve() {
+  using Blocks = NodeBlocks<sizeof(Node<int>)>;
+  LockFreeStack<int> stk;
+  stk.reserve(5000);
+  size_t reserved = Blocks::available();
+  assert(reserved >= 5000);
+  stk.reserve(5000);
+  stk.reserve(1000);
+  assert(Blocks::available() == reserved);
+
+  for (int i = 1; i <= 5000; i++)
+    stk.push(i);
+  assert(Blocks::available() == reserved - 5000);
+  uint64_t sum = 0;
+  while (!stk.isEmpty())
+    sum += stk.pop();
+  assert(sum == 5000 * 5001 / 2);
+}
+
+// FIFO stress: items are producer << 32 | sequence number. Each consumer has to see the items
+// of every producer in increasing order, which any linearizable FIFO guarantees, and every item
+// has to come out exactly once
+template <typename Queue>
+void fifo(Queue& queue) {
+  const uint64_t producers = 4, consumers = 4, per_producer = 50000;
+  std::vector<std::atomic<uint8_t>> seen(producers * per_producer);
+  std::atomic<uint64_t> count_readed = 0;
+  std::atomic<bool> in_order = true;
+  std::vector<std::thread> threads;
+
+  for (uint64_t p = 0; p < producers; p++) {
+    threads.push_back(std::thread([&, p](){
+      for (uint64_t i = 0; i < per_producer; i++)
+        queue.push(p << 32 | i);
+    }));
+  }
+  for (uint64_t c = 0; c < consumers; c++) {
+    threads.push_back(std::thread([&](){
+      std::vector<int64_t> last(producers, -1);
+      uint64_t v;
+      while (count_readed < producers * per_producer) {
+        if (!queue.tryPop(v))
+          continue;
+        uint64_t p = v >> 32, i = v & 0xffffffff;
+        if (int64_t(i) <= last[p])
+          in_order = false;
+        last[p] = i;
+        seen[p * per_producer + i].fetch_add(1, std::memory_order_relaxed);
+        count_readed.fetch_add(1);
+      }
+    }));
+  }
+  for (auto& thr : threads)
+    thr.join();
+
+  std::cout << "fifo readed: " << count_readed << "\n";
+  assert(in_order);
+  for (auto& s : seen)
+    assert(s == 1);
+  assert(queue.isEmpty());
+}
+
+int main() {
+  writeThenRead<LockFreeStack<int, HazardPointers>>();
+  writeThenRead<LockFreeStack<int, EpochReclamation>>();
+  writeThenRead<EliminationBackoffStack<int>>();
+  mixed<LockFreeStack<int, HazardPointers>>();
+  mixed<LockFreeStack<int, EpochReclamation>>();
+  mixed<LockFreeStack<int, HazardPointers, HeapNodes>>();
+  mixed<EliminationBackoffStack<int, HazardPointers>>();
+  mixed<EliminationBackoffStack<int, EpochReclamation>>();
+  mixed<EliminationBackoffStack<int, HazardPointers, HeapNodes>>();
+  bulk();
+  reserve();
+
+  LockFreeQueue<uint64_t, HazardPointers> hp_queue;
+  fifo(hp_queue);
+  LockFreeQueue<uint64_t, EpochReclamation> epoch_queue;
+  fifo(epoch_queue);
+  BoundedQueue<uint64_t> bounded_queue(1024);
+  fifo(bounded_queue);
   return 0;
-}
\ No newline at end of file
+}
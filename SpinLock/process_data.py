@@ -1,47 +1,43 @@
 #!/usr/bin/python3
 
+import csv
+import sys
 import numpy as np
 import matplotlib.pyplot as plt
-from typing import List
+from typing import Dict, List
 
-NUM_THREADS = 32
-
-def process_lock_stat(lockname: str, average: list, maximum: list):
+def process_lock_stat(lockname: str, rows: List[Dict[str, str]]):
   if lockname == "TICK": lockname = "Ticket"
   lockname += "Lock время вхождения"
-  
-  x = np.arange(1, NUM_THREADS+1)
-  y1_average = np.abs(np.array(average))
-  y1_maximum = np.array(list(int(elem // 1000) for elem in maximum))
 
-  plt.plot(x, y1_average, '.r', linestyle='', label="Среднее за 50000 итераций")
-  plt.plot(x, y1_maximum, '.g', linestyle='', label="Максимальное за 50000 итераций")
+  x = np.array(list(int(row["threads"]) for row in rows))
+  y1_p50 = np.array(list(float(row["p50 ns"]) for row in rows))
+  y1_p99 = np.array(list(float(row["p99 ns"]) for row in rows))
+  y1_maximum = np.array(list(float(row["max ns"]) / 1000 for row in rows))
+
+  plt.plot(x, y1_p50, '.r', linestyle='', label="Медиана, нс")
+  plt.plot(x, y1_p99, '.b', linestyle='', label="99-й перцентиль, нс")
+  plt.plot(x, y1_maximum, '.g', linestyle='', label="Максимальное, мкс")
   plt.xlabel("$n$ потоков")
-  plt.ylabel("$\\langle t\\rangle$, нс/ $t_{max}$, мкс")
+  plt.ylabel("$t_{50}, t_{99}$, нс/ $t_{max}$, мкс")
+  plt.yscale("log")
   plt.grid()
   plt.title(lockname)
   plt.legend()
   plt.tight_layout()
 
+# reads the CSV that bench prints by default
 if __name__ == "__main__":
 
-  params: List[str] = []
-  while True:
-    try:
-      params.append(input())
-    except:
-      break
-  
-  n_locks = len(params) // 4
+  locks: Dict[str, List[Dict[str, str]]] = {}
+  for row in csv.DictReader(sys.stdin):
+    locks.setdefault(row["lock"], []).append(row)
+
+  n_locks = len(locks)
 
   plt.figure(figsize=[6, n_locks * 6])
-  plt.subplot(n_locks, 1, 1)
-  for i in range(n_locks):
+  for i, (lockname, rows) in enumerate(locks.items()):
     plt.subplot(n_locks, 1, i+1)
-    print(params[i * 4])
-    process_lock_stat(
-      params[i * 4].upper(), 
-      list(int(elem) for elem in params[i * 4 + 1].split()),
-      list(int(elem) for elem in params[i * 4 + 2].split())
-    )
-  plt.savefig(fname="result.pdf")
\ No newline at end of file
+    print(lockname)
+    process_lock_stat(lockname.upper(), rows)
+  plt.savefig(fname="result.pdf")
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <sched.h>
+#include <thread>
+
+// Distributed ("big reader") reader-writer lock: a reader counter per CPU, each on its own cache
+// line, so readers on different CPUs never share a written line. A writer raises its flag and
+// then waits for every counter to drain, which makes writes cost O(CPUs) and is why this only
+// pays off for read-mostly data. Readers back off while the flag is up, so writers are preferred.
+// Userspace cannot pin a reader to its CPU for the section, so a thread keeps the slot of the
+// CPU it first ran a read on; slots are counters, sharing one is still correct.
+class BigReaderLock final {
+    // pause rounds before a waiter starts yielding, as in MCSLock
+    static constexpr unsigned SPINS = 128;
+
+    struct alignas(64) Slot {
+      std::atomic<uint32_t> readers{0};
+    };
+
+    alignas(64) std::atomic<bool> writer{false};
+    size_t n_slots;
+    std::unique_ptr<Slot[]> slots;
+
+    static void relax(unsigned spins) {
+      if (spins < SPINS)
+        asm volatile ("pause");
+      else
+        std::this_thread::yield();
+    }
+
+    Slot& mySlot() {
+      thread_local unsigned cpu = [](){
+        int c = sched_getcpu();
+        return c < 0 ? 0u : unsigned(c);
+      }();
+      return slots[cpu % n_slots];
+    }
+
+  public:
+    explicit BigReaderLock(size_t n_slots_ = std::thread::hardware_concurrency())
+      : n_slots(n_slots_ ? n_slots_ : 1), slots(new Slot[n_slots]) {}
+
+    void lock() {
+      for (unsigned spins = 0; writer.exchange(true, std::memory_order_seq_cst); spins++) {
+        while (writer.load(std::memory_order_relaxed))
+          relax(spins++);
+      }
+      for (size_t i = 0; i < n_slots; i++) {
+        for (unsigned spins = 0; slots[i].readers.load(std::memory_order_seq_cst) != 0; spins++)
+          relax(spins);
+      }
+    }
+
+    void unlock() {
+      writer.store(false, std::memory_order_release);
+    }
+
+    void lock_shared() {
+      Slot& slot = mySlot();
+      for (unsigned spins = 0;; spins++) {
+        // pairs with the writer's flag exchange and slot loads, both seq_cst
+        slot.readers.fetch_add(1, std::memory_order_seq_cst);
+        if (!writer.load(std::memory_order_seq_cst))
+          return;
+        slot.readers.fetch_sub(1, std::memory_order_relaxed);
+        while (writer.load(std::memory_order_relaxed))
+          relax(spins++);
+      }
+    }
+
+    void unlock_shared() {
+      mySlot().readers.fetch_sub(1, std::memory_order_release);
+    }
+};
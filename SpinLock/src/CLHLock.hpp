@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Craig, Landin and Hagersten queue lock. A waiter swaps its node into the tail and spins on
+// the node of its predecessor; unlock only clears the flag of its own node. Nodes change hands:
+// the successor may still be reading the releaser's node, so the releaser keeps the node of its
+// predecessor instead, which nobody looks at any more.
+class CLHLock final {
+  public:
+    struct alignas(64) Node {
+      std::atomic<bool> locked{false};
+    };
+
+  private:
+    // pause rounds before a waiter starts yielding, as in MCSLock
+    static constexpr unsigned SPINS = 128;
+
+    std::atomic<Node*> tail;
+    // nodes of the thread holding the lock through lock(), touched by the holder only
+    Node* holder = nullptr;
+    Node* holder_pred = nullptr;
+
+    struct FreeNodes {
+      std::vector<Node*> nodes;
+
+      ~FreeNodes() {
+        for (Node* node : nodes)
+          delete node;
+      }
+    };
+
+    static FreeNodes& freeNodes() {
+      thread_local FreeNodes free_nodes;
+      return free_nodes;
+    }
+
+    static void relax(unsigned spins) {
+      if (spins < SPINS)
+        asm volatile ("pause");
+      else
+        std::this_thread::yield();
+    }
+
+    static Node* takeNode() {
+      auto& free_nodes = freeNodes().nodes;
+      if (free_nodes.empty())
+        return new Node;
+      Node* node = free_nodes.back();
+      free_nodes.pop_back();
+      return node;
+    }
+
+  public:
+    CLHLock() : tail(new Node) {}
+
+    CLHLock(const CLHLock&) = delete;
+    CLHLock& operator=(const CLHLock&) = delete;
+
+    // the node of the last holder, or the initial one
+    ~CLHLock() {
+      delete tail.load(std::memory_order_relaxed);
+    }
+
+    // node must not be in use; returns the predecessor's node, to be passed to unlock
+    Node* lock(Node* node) {
+      node->locked.store(true, std::memory_order_relaxed);
+      Node* pred = tail.exchange(node, std::memory_order_acq_rel);
+      for (unsigned spins = 0; pred->locked.load(std::memory_order_acquire); spins++)
+        relax(spins);
+      return pred;
+    }
+
+    // releases with the node given to lock; returns the node the caller owns from now on
+    Node* unlock(Node* node, Node* pred) {
+      node->locked.store(false, std::memory_order_release);
+      return pred;
+    }
+
+    void lock() {
+      Node* node = takeNode();
+      Node* pred = lock(node);
+      holder = node;
+      holder_pred = pred;
+    }
+
+    void unlock() {
+      Node* node = holder;
+      Node* pred = holder_pred;
+      freeNodes().nodes.push_back(unlock(node, pred));
+    }
+
+    // holds the lock for its scope; its nodes come from and go back to the thread's free nodes
+    class Guard {
+        CLHLock& lock;
+        Node* node;
+        Node* pred;
+
+      public:
+        explicit Guard(CLHLock& lock_) : lock(lock_), node(takeNode()) {
+          pred = lock.lock(node);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+          freeNodes().nodes.push_back(lock.unlock(node, pred));
+        }
+    };
+};
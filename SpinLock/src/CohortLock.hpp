@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// CPU to NUMA node map read from /sys/devices/system/node, one node when that is unavailable.
+// Node ids can have gaps, so nodes() is one past the highest id rather than the count.
+class NumaTopology final {
+    std::vector<unsigned> node_of_cpu;
+    unsigned n_nodes = 1;
+
+    // a sysfs list such as 0-3,8-11
+    static std::vector<unsigned> readList(const std::string& path) {
+      std::vector<unsigned> ids;
+      std::ifstream in(path);
+      std::string range;
+      while (std::getline(in, range, ',')) {
+        std::istringstream parse(range);
+        unsigned first, last;
+        char dash;
+        if (!(parse >> first))
+          continue;
+        if (!(parse >> dash >> last))
+          last = first;
+        for (unsigned id = first; id <= last; id++)
+          ids.push_back(id);
+      }
+      return ids;
+    }
+
+  public:
+    // root is the sysfs node directory, another one only in tests
+    explicit NumaTopology(const std::string& root = "/sys/devices/system/node") {
+      for (unsigned node : readList(root + "/online")) {
+        for (unsigned cpu : readList(root + "/node" + std::to_string(node) + "/cpulist")) {
+          if (node_of_cpu.size() <= cpu)
+            node_of_cpu.resize(cpu + 1, 0);
+          node_of_cpu[cpu] = node;
+        }
+        if (node + 1 > n_nodes)
+          n_nodes = node + 1;
+      }
+    }
+
+    static const NumaTopology& get() {
+      static const NumaTopology topology;
+      return topology;
+    }
+
+    unsigned nodes() const {
+      return n_nodes;
+    }
+
+    unsigned nodeOf(unsigned cpu) const {
+      return cpu < node_of_cpu.size() ? node_of_cpu[cpu] : 0;
+    }
+};
+
+// Cohort lock (Dice, Marathe, Shavit, "Lock Cohorting"): a global ticket lock plus a ticket lock
+// per NUMA node. A thread first takes the lock of its node, and the global one only if its node
+// does not hold it already. On unlock, if another thread of the same node is queued, the global
+// lock stays with the node and only the local lock is handed over, at most MAX_BATCH times in a
+// row so that other nodes are not starved. The protected data thus moves between nodes once per
+// batch rather than on almost every handoff as with a plain TicketLock. A ticket lock works as
+// the global lock since it does not care which thread releases it, and as the local one since
+// it can tell if anybody is waiting. As in BigReaderLock a thread keeps the node of the CPU it
+// first ran on; a wrong guess costs locality, not correctness.
+class CohortLock final {
+    // pause rounds before a waiter starts yielding, as in MCSLock
+    static constexpr unsigned SPINS = 128;
+
+    struct alignas(64) Cohort {
+      std::atomic<uint64_t> next_ticket{0};
+      std::atomic<uint64_t> current{0};
+      // touched by the holder only, handed over together with the local lock
+      bool owns_global = false;
+      unsigned batch = 0;
+    };
+
+    alignas(64) std::atomic<uint64_t> next_ticket{0};
+    std::atomic<uint64_t> current{0};
+    unsigned max_batch;
+    unsigned n_cohorts;
+    std::unique_ptr<Cohort[]> cohorts;
+    // cohort of the thread holding the lock, touched by the holder only
+    alignas(64) Cohort* holder = nullptr;
+
+    static void relax(unsigned spins) {
+      if (spins < SPINS)
+        asm volatile ("pause");
+      else
+        std::this_thread::yield();
+    }
+
+    static int& boundNode() {
+      thread_local int node = -1;
+      return node;
+    }
+
+    static void takeTicket(std::atomic<uint64_t>& next, std::atomic<uint64_t>& now_serving) {
+      const uint64_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+      for (unsigned spins = 0; now_serving.load(std::memory_order_acquire) != ticket; spins++)
+        relax(spins);
+    }
+
+  public:
+    static constexpr unsigned MAX_BATCH = 64;
+
+    explicit CohortLock(unsigned n_nodes = NumaTopology::get().nodes(), unsigned max_batch_ = MAX_BATCH)
+      : max_batch(max_batch_), n_cohorts(n_nodes ? n_nodes : 1), cohorts(new Cohort[n_cohorts]) {}
+
+    // node of the calling thread: the one given to bindThreadToNode, or else the node of the CPU
+    // the thread first asked on
+    static unsigned threadNode() {
+      thread_local unsigned cpu_node = [](){
+        int c = sched_getcpu();
+        return NumaTopology::get().nodeOf(c < 0 ? 0u : unsigned(c));
+      }();
+      int bound = boundNode();
+      return bound < 0 ? cpu_node : unsigned(bound);
+    }
+
+    // for emulating several nodes on a machine with one, in tests and benchmarks
+    static void bindThreadToNode(unsigned node) {
+      boundNode() = int(node);
+    }
+
+    void lock() {
+      Cohort& cohort = cohorts[threadNode() % n_cohorts];
+      takeTicket(cohort.next_ticket, cohort.current);
+      if (!cohort.owns_global)
+        takeTicket(next_ticket, current);
+      holder = &cohort;
+    }
+
+    void unlock() {
+      Cohort& cohort = *holder;
+      const uint64_t served = cohort.current.load(std::memory_order_relaxed);
+      bool waiters = cohort.next_ticket.load(std::memory_order_relaxed) != served + 1;
+      if (waiters && cohort.batch < max_batch) {
+        cohort.batch++;
+        cohort.owns_global = true;
+      }
+      else {
+        cohort.batch = 0;
+        cohort.owns_global = false;
+        current.fetch_add(1, std::memory_order_release);
+      }
+      cohort.current.store(served + 1, std::memory_order_release);
+    }
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+// Spins for a while and then sleeps on a futex. The state word is 0 when free, 1 when held and
+// 2 when held with sleepers possible (Drepper, "Futexes are tricky", mutex 2), so an unlock
+// makes the wake syscall only if somebody went to sleep. How long to spin follows the hold
+// times the holders observe: a waiter spins for about twice the recent average hold, since
+// beyond that the holder is probably preempted or in a long section and a sleep is cheaper.
+class HybridLock final {
+    // bounds of the spin budget in TSC cycles, the upper one around the cost of a futex round
+    static constexpr int64_t MIN_SPIN = 1000;
+    static constexpr int64_t MAX_SPIN = 50000;
+
+    std::atomic<uint32_t> state{0};
+    // moving average of hold times in TSC cycles, updated by each holder at unlock
+    std::atomic<int64_t> avg_hold{MIN_SPIN};
+    // touched by the holder only
+    uint64_t acquired_at = 0;
+
+    static void futexWait(std::atomic<uint32_t>* addr, uint32_t expected) {
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    static void futexWake(std::atomic<uint32_t>* addr, int count) {
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+
+    bool trySpin() {
+      int64_t budget = 2 * avg_hold.load(std::memory_order_relaxed);
+      budget = budget < MIN_SPIN ? MIN_SPIN : budget > MAX_SPIN ? MAX_SPIN : budget;
+      uint64_t start = __rdtsc();
+      while (int64_t(__rdtsc() - start) < budget) {
+        uint32_t c = state.load(std::memory_order_relaxed);
+        if (c == 0 && state.compare_exchange_weak(c, 1, std::memory_order_acquire, std::memory_order_relaxed))
+          return true;
+        asm volatile ("pause");
+      }
+      return false;
+    }
+
+  public:
+    void lock() {
+      uint32_t c = 0;
+      if (!state.compare_exchange_strong(c, 1, std::memory_order_acquire, std::memory_order_relaxed) && !trySpin()) {
+        // from here on the state says there may be sleepers, whoever unlocks wakes one
+        c = state.exchange(2, std::memory_order_acquire);
+        while (c != 0) {
+          futexWait(&state, 2);
+          c = state.exchange(2, std::memory_order_acquire);
+        }
+      }
+      acquired_at = __rdtsc();
+    }
+
+    void unlock() {
+      int64_t held = int64_t(__rdtsc() - acquired_at);
+      int64_t avg = avg_hold.load(std::memory_order_relaxed);
+      avg_hold.store(avg + (held - avg) / 8, std::memory_order_relaxed);
+      if (state.exchange(0, std::memory_order_release) == 2)
+        futexWake(&state, 1);
+    }
+};
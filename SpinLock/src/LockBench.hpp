@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <x86intrin.h>
+
+// Log-linear histogram in the manner of HdrHistogram: values below 64 are exact, above that
+// each power of two is split into 32 buckets, so any value is off by at most about 3%.
+class LatencyHistogram {
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB = 1 << SUB_BITS;
+    // the exact row plus one row per shift, up to that of a value with bit 63 set
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    std::vector<uint64_t> counts = std::vector<uint64_t>(BUCKETS, 0);
+    uint64_t total = 0;
+    uint64_t max_value = 0;
+
+    static size_t index(uint64_t v) {
+      if (v < 2 * SUB)
+        return v;
+      int shift = 63 - __builtin_clzll(v) - SUB_BITS;
+      return (shift + 1) * SUB + ((v >> shift) - SUB);
+    }
+
+    // the largest value that lands in bucket i
+    static uint64_t highest(size_t i) {
+      if (i < 2 * SUB)
+        return i;
+      int shift = i / SUB - 1;
+      return ((i % SUB + SUB + 1) << shift) - 1;
+    }
+
+  public:
+    void record(uint64_t v) {
+      counts[index(v)]++;
+      total++;
+      max_value = std::max(max_value, v);
+    }
+
+    void merge(const LatencyHistogram& other) {
+      for (size_t i = 0; i < BUCKETS; i++)
+        counts[i] += other.counts[i];
+      total += other.total;
+      max_value = std::max(max_value, other.max_value);
+    }
+
+    uint64_t count() const {
+      return total;
+    }
+
+    uint64_t max() const {
+      return max_value;
+    }
+
+    uint64_t percentile(double q) const {
+      uint64_t rank = std::max<uint64_t>(1, uint64_t(q * total + 0.5));
+      uint64_t seen = 0;
+      for (size_t i = 0; i < BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank)
+          return std::min(highest(i), max_value);
+      }
+      return max_value;
+    }
+};
+
+struct LockBenchConfig {
+    unsigned threads = 1;
+    std::chrono::milliseconds duration{200};
+    // cache lines of a shared buffer written inside the critical section
+    unsigned cs_lines = 1;
+};
+
+struct LockBenchResult {
+    std::string lock_name;
+    unsigned threads = 0;
+    unsigned cs_lines = 0;
+    uint64_t acquisitions = 0;
+    double mops = 0;
+    // time spent in lock(), over every acquisition of every thread
+    double p50_ns = 0;
+    double p99_ns = 0;
+    double p999_ns = 0;
+    double max_ns = 0;
+    // Jain's index of the per-thread acquisition counts, 1 when all threads got the same share,
+    // and the smallest and largest share relative to an even split
+    double fairness = 1;
+    double min_share = 1;
+    double max_share = 1;
+    double cpu_ms = 0;
+    double wall_ms = 0;
+};
+
+// rdtsc ticks per nanosecond, measured once against steady_clock
+inline double tscPerNs() {
+  static const double ratio = [](){
+    auto start = std::chrono::steady_clock::now();
+    uint64_t tsc_start = __rdtsc();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20));
+    uint64_t tsc_end = __rdtsc();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return double(tsc_end - tsc_start) / ns;
+  }();
+  return ratio;
+}
+
+// Every thread takes and releases `lock` in a loop for cfg.duration, timing each lock() with
+// rdtsc into its own histogram. Works with any type that has lock() and unlock().
+template <typename Lockable>
+LockBenchResult runLockBench(const std::string& lock_name, Lockable& lock, const LockBenchConfig& cfg) {
+  struct alignas(64) Line {
+    uint64_t value = 0;
+  };
+  struct alignas(64) PerThread {
+    LatencyHistogram latency;
+    uint64_t acquisitions = 0;
+  };
+
+  std::vector<Line> shared(std::max(1u, cfg.cs_lines));
+  std::vector<PerThread> results(cfg.threads);
+  std::atomic<unsigned> ready = 0;
+  std::atomic<bool> go = false;
+  std::atomic<bool> stop = false;
+  std::vector<std::thread> threads;
+
+  for (unsigned t = 0; t < cfg.threads; t++) {
+    threads.push_back(std::thread([&, t](){
+      PerThread& r = results[t];
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire));
+      while (!stop.load(std::memory_order_relaxed)) {
+        uint64_t begin = __rdtsc();
+        lock.lock();
+        // after a migration to a core whose TSC is behind the difference is negative
+        int64_t cycles = int64_t(__rdtsc() - begin);
+        r.latency.record(cycles < 0 ? 0 : uint64_t(cycles));
+        for (unsigned i = 0; i < cfg.cs_lines; i++)
+          shared[i].value++;
+        lock.unlock();
+        r.acquisitions++;
+      }
+    }));
+  }
+  while (ready.load() != cfg.threads);
+
+  auto cpu_start = std::clock();
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(cfg.duration);
+  stop.store(true, std::memory_order_relaxed);
+  for (auto& thr : threads)
+    thr.join();
+  auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  LockBenchResult res;
+  res.lock_name = lock_name;
+  res.threads = cfg.threads;
+  res.cs_lines = cfg.cs_lines;
+  res.cpu_ms = double(std::clock() - cpu_start) * 1000 / CLOCKS_PER_SEC;
+  res.wall_ms = wall_ns / 1e6;
+
+  LatencyHistogram latency;
+  double sum = 0, sum_sq = 0;
+  uint64_t least = UINT64_MAX, most = 0;
+  for (auto& r : results) {
+    latency.merge(r.latency);
+    res.acquisitions += r.acquisitions;
+    sum += r.acquisitions;
+    sum_sq += double(r.acquisitions) * r.acquisitions;
+    least = std::min(least, r.acquisitions);
+    most = std::max(most, r.acquisitions);
+  }
+  res.mops = res.acquisitions * 1000.0 / wall_ns;
+
+  double per_ns = tscPerNs();
+  res.p50_ns = latency.percentile(0.5) / per_ns;
+  res.p99_ns = latency.percentile(0.99) / per_ns;
+  res.p999_ns = latency.percentile(0.999) / per_ns;
+  res.max_ns = latency.max() / per_ns;
+  if (sum > 0) {
+    double even = sum / cfg.threads;
+    res.fairness = sum * sum / (cfg.threads * sum_sq);
+    res.min_share = least / even;
+    res.max_share = most / even;
+  }
+  return res;
+}
+
+inline void printCsvHeader(std::ostream& out) {
+  out << "lock,threads,cs lines,acquisitions,Mops/s,p50 ns,p99 ns,p99.9 ns,max ns,"
+      << "fairness,min share,max share,wall ms,cpu ms\n";
+}
+
+inline void printCsv(std::ostream& out, const LockBenchResult& r) {
+  out << r.lock_name << "," << r.threads << "," << r.cs_lines << "," << r.acquisitions << "," << r.mops << ","
+      << r.p50_ns << "," << r.p99_ns << "," << r.p999_ns << "," << r.max_ns << ","
+      << r.fairness << "," << r.min_share << "," << r.max_share << "," << r.wall_ms << "," << r.cpu_ms << "\n";
+}
+
+inline void printJson(std::ostream& out, const std::vector<LockBenchResult>& results) {
+  out << "[\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& r = results[i];
+    out << "  {\"lock\": \"" << r.lock_name << "\", \"threads\": " << r.threads << ", \"cs_lines\": " << r.cs_lines
+        << ", \"acquisitions\": " << r.acquisitions << ", \"mops\": " << r.mops
+        << ", \"p50_ns\": " << r.p50_ns << ", \"p99_ns\": " << r.p99_ns << ", \"p999_ns\": " << r.p999_ns
+        << ", \"max_ns\": " << r.max_ns << ", \"fairness\": " << r.fairness
+        << ", \"min_share\": " << r.min_share << ", \"max_share\": " << r.max_share
+        << ", \"wall_ms\": " << r.wall_ms << ", \"cpu_ms\": " << r.cpu_ms << "}"
+        << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "]\n";
+}
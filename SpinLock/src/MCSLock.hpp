@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Mellor-Crummey and Scott queue lock. Waiters form a linked queue of nodes and each spins
+// on the flag of its own node, so a handoff touches one cache line of the next waiter only
+// and waiters are served in arrival order.
+class MCSLock final {
+  public:
+    struct alignas(64) Node {
+      std::atomic<Node*> next{nullptr};
+      std::atomic<bool> locked{false};
+    };
+
+  private:
+    // pause rounds before a waiter starts yielding, so that a preempted thread ahead in the
+    // queue gets to run when there are more threads than cores
+    static constexpr unsigned SPINS = 128;
+
+    std::atomic<Node*> tail{nullptr};
+    // node of the thread holding the lock through lock(), touched by the holder only
+    Node* holder = nullptr;
+
+    // lock() takes its node from here and unlock() gives it back, so nested and
+    // interleaved locks of one thread get distinct nodes
+    struct FreeNodes {
+      std::vector<Node*> nodes;
+
+      ~FreeNodes() {
+        for (Node* node : nodes)
+          delete node;
+      }
+    };
+
+    static FreeNodes& freeNodes() {
+      thread_local FreeNodes free_nodes;
+      return free_nodes;
+    }
+
+    static void relax(unsigned spins) {
+      if (spins < SPINS)
+        asm volatile ("pause");
+      else
+        std::this_thread::yield();
+    }
+
+  public:
+    // with a node of the caller's that must stay alive until the matching unlock
+    void lock(Node& node) {
+      node.next.store(nullptr, std::memory_order_relaxed);
+      node.locked.store(true, std::memory_order_relaxed);
+      Node* pred = tail.exchange(&node, std::memory_order_acq_rel);
+      if (pred) {
+        pred->next.store(&node, std::memory_order_release);
+        for (unsigned spins = 0; node.locked.load(std::memory_order_acquire); spins++)
+          relax(spins);
+      }
+    }
+
+    void unlock(Node& node) {
+      Node* succ = node.next.load(std::memory_order_acquire);
+      if (!succ) {
+        Node* expected = &node;
+        if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed))
+          return;
+        // a successor has swapped the tail but not linked itself yet
+        for (unsigned spins = 0; !(succ = node.next.load(std::memory_order_acquire)); spins++)
+          relax(spins);
+      }
+      succ->locked.store(false, std::memory_order_release);
+    }
+
+    void lock() {
+      auto& free_nodes = freeNodes().nodes;
+      Node* node;
+      if (free_nodes.empty()) {
+        node = new Node;
+      }
+      else {
+        node = free_nodes.back();
+        free_nodes.pop_back();
+      }
+      lock(*node);
+      holder = node;
+    }
+
+    void unlock() {
+      Node* node = holder;
+      unlock(*node);
+      freeNodes().nodes.push_back(node);
+    }
+
+    // holds the lock for its scope with the node on the stack
+    class Guard {
+        MCSLock& lock;
+        Node node;
+
+      public:
+        explicit Guard(MCSLock& lock_) : lock(lock_) {
+          lock.lock(node);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+          lock.unlock(node);
+        }
+    };
+};
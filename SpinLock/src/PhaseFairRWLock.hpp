@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// Phase-fair ticket reader-writer lock (Brandenburg, Anderson: PF-T). Writers queue on a
+// ticket pair and take turns. A writer that comes up announces itself in the low bits of the
+// reader entry counter: readers arriving after that wait for exactly that one writer phase, while
+// the writer waits for the readers already inside. So read and write phases alternate, a writer
+// waits for at most one read phase and a reader for at most one write phase.
+class PhaseFairRWLock final {
+    static constexpr uint32_t RINC = 0x100;
+    // writer present and the parity of its ticket, so readers can tell one writer phase from the next
+    static constexpr uint32_t WBITS = 0x3;
+    static constexpr uint32_t PRES = 0x2;
+    static constexpr uint32_t PHID = 0x1;
+    // pause rounds before a waiter starts yielding, as in MCSLock
+    static constexpr unsigned SPINS = 128;
+
+    alignas(64) std::atomic<uint32_t> rin{0};
+    alignas(64) std::atomic<uint32_t> rout{0};
+    alignas(64) std::atomic<uint32_t> win{0};
+    std::atomic<uint32_t> wout{0};
+
+    static void relax(unsigned spins) {
+      if (spins < SPINS)
+        asm volatile ("pause");
+      else
+        std::this_thread::yield();
+    }
+
+  public:
+    void lock() {
+      uint32_t ticket = win.fetch_add(1, std::memory_order_relaxed);
+      for (unsigned spins = 0; wout.load(std::memory_order_acquire) != ticket; spins++)
+        relax(spins);
+      // readers that came in before this point are the ones to wait for
+      uint32_t readers = rin.fetch_add(PRES | (ticket & PHID), std::memory_order_acq_rel);
+      for (unsigned spins = 0; rout.load(std::memory_order_acquire) != readers; spins++)
+        relax(spins);
+    }
+
+    void unlock() {
+      rin.fetch_and(~WBITS, std::memory_order_release);
+      wout.fetch_add(1, std::memory_order_release);
+    }
+
+    void lock_shared() {
+      uint32_t w = rin.fetch_add(RINC, std::memory_order_acquire) & WBITS;
+      for (unsigned spins = 0; w != 0 && w == (rin.load(std::memory_order_acquire) & WBITS); spins++)
+        relax(spins);
+    }
+
+    void unlock_shared() {
+      rout.fetch_add(RINC, std::memory_order_release);
+    }
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// Reader-writer spinlock on one counter: the top bit marks a writer, the rest counts readers.
+// A reader is one fetch_add when there is no writer, but every reader writes the same cache
+// line, and a steady stream of readers keeps a writer out.
+class RWSpinLock final {
+    static constexpr uint32_t WRITER = 1u << 31;
+    // pause rounds before a waiter starts yielding, as in MCSLock
+    static constexpr unsigned SPINS = 128;
+
+    std::atomic<uint32_t> state{0};
+
+    static void relax(unsigned spins) {
+      if (spins < SPINS)
+        asm volatile ("pause");
+      else
+        std::this_thread::yield();
+    }
+
+  public:
+    void lock() {
+      uint32_t expected = 0;
+      for (unsigned spins = 0; !state.compare_exchange_weak(expected, WRITER, std::memory_order_acquire, std::memory_order_relaxed); spins++) {
+        expected = 0;
+        relax(spins);
+      }
+    }
+
+    void unlock() {
+      state.fetch_and(~WRITER, std::memory_order_release);
+    }
+
+    void lock_shared() {
+      for (unsigned spins = 0;; spins++) {
+        if (!(state.fetch_add(1, std::memory_order_acquire) & WRITER))
+          return;
+        state.fetch_sub(1, std::memory_order_relaxed);
+        while (state.load(std::memory_order_relaxed) & WRITER)
+          relax(spins++);
+      }
+    }
+
+    void unlock_shared() {
+      state.fetch_sub(1, std::memory_order_release);
+    }
+};
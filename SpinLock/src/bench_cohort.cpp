@@ -0,0 +1,82 @@
+// CohortLock against TicketLock with a critical section that writes a shared buffer, which on a
+// NUMA machine moves to the node of each new holder. Besides throughput it counts cross-node
+// handoffs: acquisitions whose holder is on another node than the previous holder. Threads are
+// spread round-robin over `nodes` nodes; by default the real ones, and on a machine with fewer
+// the nodes are emulated, which shows the handoff pattern though not the cost of the traffic.
+// usage: bench_cohort [max_threads] [nodes] [buffer_lines] [ms_per_run]
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TicketLock.hpp"
+#include "CohortLock.hpp"
+
+struct alignas(64) Line {
+    uint64_t value = 0;
+};
+
+template <typename Lock>
+void run(const std::string& lock_name, Lock& lock, unsigned n_threads, unsigned n_nodes,
+         unsigned buffer_lines, std::chrono::milliseconds duration) {
+  std::vector<Line> buffer(buffer_lines);
+  // written inside the critical section only
+  unsigned last_node = 0;
+  uint64_t acquisitions = 0;
+  uint64_t cross_node = 0;
+  std::atomic<bool> go = false;
+  std::atomic<bool> stop = false;
+  std::vector<std::thread> threads;
+
+  for (unsigned t = 0; t < n_threads; t++) {
+    threads.push_back(std::thread([&, t](){
+      unsigned node = t % n_nodes;
+      CohortLock::bindThreadToNode(node);
+      while (!go.load(std::memory_order_acquire));
+      while (!stop.load(std::memory_order_relaxed)) {
+        lock.lock();
+        if (acquisitions++ > 0 && node != last_node)
+          cross_node++;
+        last_node = node;
+        for (auto& line : buffer)
+          line.value++;
+        lock.unlock();
+      }
+    }));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(duration);
+  stop.store(true, std::memory_order_relaxed);
+  for (auto& thr : threads)
+    thr.join();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << lock_name << "," << n_nodes << "," << n_threads << "," << acquisitions << ","
+            << acquisitions * 1000.0 / ns << "," << cross_node << ","
+            << (acquisitions ? cross_node * 1000.0 / acquisitions : 0) << "\n";
+}
+
+int main(int argc, char** argv) {
+  unsigned max_threads = argc > 1 ? std::stoul(argv[1]) : 2 * std::thread::hardware_concurrency();
+  unsigned n_nodes = argc > 2 ? std::stoul(argv[2]) : NumaTopology::get().nodes();
+  unsigned buffer_lines = argc > 3 ? std::stoul(argv[3]) : 16;
+  std::chrono::milliseconds duration(argc > 4 ? std::stoul(argv[4]) : 200);
+  if (n_nodes == 0)
+    n_nodes = 1;
+
+  std::cout << "lock,nodes,threads,acquisitions,Mops/s,cross-node handoffs,per 1000 acquisitions\n";
+  for (unsigned n = 1; n <= max_threads; n *= 2) {
+    TicketLock tick;
+    CohortLock cohort8(n_nodes, 8);
+    CohortLock cohort64(n_nodes, 64);
+    run("tick", tick, n, n_nodes, buffer_lines, duration);
+    run("cohort/8", cohort8, n, n_nodes, buffer_lines, duration);
+    run("cohort/64", cohort64, n, n_nodes, buffer_lines, duration);
+  }
+
+  return 0;
+}
@@ -0,0 +1,75 @@
+// Throughput of the reader-writer locks, with std::shared_mutex as the baseline, over read
+// shares from 100% down to 50% and 1 to max_threads threads. A read sums a small table, a write
+// bumps every entry of it.
+// usage: bench_rw [max_threads] [ops_per_thread]
+#include <chrono>
+#include <iostream>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RWSpinLock.hpp"
+#include "PhaseFairRWLock.hpp"
+#include "BigReaderLock.hpp"
+
+const int TABLE_SIZE = 16;
+
+template <typename Lock>
+void run(const std::string& lock_name, unsigned n_threads, unsigned read_percent, unsigned ops) {
+  Lock lock;
+  uint64_t table[TABLE_SIZE] = {};
+  std::atomic<bool> go = false;
+  std::vector<std::thread> threads;
+
+  for (unsigned t = 0; t < n_threads; t++) {
+    threads.push_back(std::thread([&, t](){
+      uint32_t x = 2463534242u + t;
+      uint64_t sum = 0;
+      while (!go.load(std::memory_order_acquire));
+      for (unsigned i = 0; i < ops; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        if (x % 100 < read_percent) {
+          lock.lock_shared();
+          for (int k = 0; k < TABLE_SIZE; k++)
+            sum += table[k];
+          lock.unlock_shared();
+        }
+        else {
+          lock.lock();
+          for (int k = 0; k < TABLE_SIZE; k++)
+            table[k]++;
+          lock.unlock();
+        }
+      }
+      asm volatile ("" : : "r"(sum));
+    }));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& thr : threads)
+    thr.join();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t total = uint64_t(ops) * n_threads;
+  std::cout << lock_name << "," << read_percent << "," << n_threads << "," << total << "," << total * 1000.0 / ns << "\n";
+}
+
+int main(int argc, char** argv) {
+  unsigned max_threads = argc > 1 ? std::stoul(argv[1]) : 32;
+  unsigned ops = argc > 2 ? std::stoul(argv[2]) : 100000;
+
+  std::cout << "lock,read %,threads,ops,Mops/s\n";
+  for (unsigned read_percent : {100, 99, 95, 90, 75, 50}) {
+    for (unsigned n = 1; n <= max_threads; n *= 2) {
+      run<RWSpinLock>("centralized", n, read_percent, ops);
+      run<PhaseFairRWLock>("phase-fair", n, read_percent, ops);
+      run<BigReaderLock>("big-reader", n, read_percent, ops);
+      run<std::shared_mutex>("std::shared_mutex", n, read_percent, ops);
+    }
+  }
+  return 0;
+}
@@ -2,81 +2,78 @@
 #include <chrono>
 #include <thread>
 #include <vector>
-#include <algorithm>
-#include <numeric>
+#include <string>
 
 #include "TASLock.hpp"
 #include "TTASLock.hpp"
 #include "TicketLock.hpp"
+#include "MCSLock.hpp"
+#include "CLHLock.hpp"
+#include "HybridLock.hpp"
+#include "CohortLock.hpp"
+#include "LockBench.hpp"
 
 TASLock tas;
 TTASLock ttas;
 TicketLock tick;
+MCSLock mcs;
+CLHLock clh;
+HybridLock hybrid;
+CohortLock cohort;
 
-const int ITER_NUM = 50000;
-
-void printStat(
-    const std::string lock_name, 
-    const std::vector<int64_t>& average, // index of array equal to number of threads in test
-    const std::vector<int64_t>& maximum  // index of array equal to number of threads in test
-) {
-  std::cout << lock_name << "\n";
-  for (auto& dur : average) {
-    std::cout << dur << " ";
-  }
-  std::cout << "\n";
-  for (auto& dur : maximum) {
-    std::cout << dur << " ";
-  }
-  std::cout << "\n\n";
+// runs every lock with each thread count in `threads`
+void sweep(const std::vector<unsigned>& threads, LockBenchConfig cfg, std::vector<LockBenchResult>& results) {
+  auto run = [&](const std::string& lock_name, auto& lock) {
+    for (unsigned n : threads) {
+      cfg.threads = n;
+      results.push_back(runLockBench(lock_name, lock, cfg));
+    }
+  };
+  run("tas", tas);
+  run("ttas", ttas);
+  run("tick", tick);
+  run("mcs", mcs);
+  run("clh", clh);
+  run("hybrid", hybrid);
+  run("cohort", cohort);
 }
 
-#define DECLARE_TEST(lock_prefix) \
-void lock_prefix##Test() { \
-  std::vector<std::thread> threads; \
-  std::vector<int64_t> average((size_t)32, 0); \
-  std::vector<int64_t> maximum((size_t)32, 0); \
-  auto worker = [](uint64_t* counter){ \
-    for (int i = 0; i < ITER_NUM; i++) { \
-      lock_prefix.lock(); \
-      (*counter)++; \
-      lock_prefix.unlock(); \
-    } \
-  }; \
-  for (int n = 0; n < 32; n++) { \
-    uint64_t counter; \
-    std::vector<int64_t> diffs((size_t)ITER_NUM, 0); \
-    int64_t max_; \
-    std::chrono::system_clock clk; \
-    for (int i = 0; i < n; i++) { \
-      threads.push_back(std::thread(worker, &counter)); \
-    } \
-    for (int i = 0; i < ITER_NUM; i++) { \
-      auto st = clk.now(); \
-      lock_prefix.lock(); \
-      auto end = clk.now(); \
-      counter++; \
-      lock_prefix.unlock(); \
-      diffs[i] = std::chrono::duration_cast<std::chrono::nanoseconds>((end - st)).count(); \
-    } \
-    for (auto& thr : threads) \
-      thr.join(); \
-    threads.clear(); \
-    average[n] = std::accumulate(diffs.begin(), diffs.end(), 0) / ITER_NUM; \
-    for (int i = 0; i < ITER_NUM; i++) \
-      maximum[n] = (maximum[n] >= diffs[i]) ? maximum[n] : diffs[i]; \
-  } \
-  printStat(#lock_prefix, average, maximum); \
-} 
+// bench [csv|json] [max threads] [cs lines] [ms per run]
+//     - every lock over 1..max threads (32 by default), CSV for process_data.py
+// bench oversubscribed [n] [csv|json]
+//     - n threads (4 per core by default); with more threads than cores a waiter that spins
+//       while the holder is preempted burns its timeslice, which shows as CPU time far above
+//       the wall time
+int main(int argc, char** argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  std::vector<unsigned> threads;
+  LockBenchConfig cfg;
+  bool json = false;
 
-DECLARE_TEST(tas)
-DECLARE_TEST(ttas)
-DECLARE_TEST(tick)
+  if (!args.empty() && args[0] == "oversubscribed") {
+    threads.push_back(args.size() > 1 ? std::stoul(args[1]) : 4 * std::thread::hardware_concurrency());
+    json = args.size() > 2 && args[2] == "json";
+  }
+  else {
+    json = args.size() > 0 && args[0] == "json";
+    unsigned max_threads = args.size() > 1 ? std::stoul(args[1]) : 32;
+    if (args.size() > 2)
+      cfg.cs_lines = std::stoul(args[2]);
+    if (args.size() > 3)
+      cfg.duration = std::chrono::milliseconds(std::stoul(args[3]));
+    for (unsigned n = 1; n <= max_threads; n++)
+      threads.push_back(n);
+  }
 
-int main() {
-  tasTest();
-  ttasTest();
-  tickTest();
+  std::vector<LockBenchResult> results;
+  if (!json)
+    printCsvHeader(std::cout);
+  sweep(threads, cfg, results);
+  if (json)
+    printJson(std::cout, results);
+  else
+    for (auto& r : results)
+      printCsv(std::cout, r);
 
   return 0;
-}
\ No newline at end of file
+}
@@ -1,13 +1,26 @@
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
 #include <list>
 
 #include "TASLock.hpp"
 #include "TTASLock.hpp"
 #include "TicketLock.hpp"
+#include "MCSLock.hpp"
+#include "CLHLock.hpp"
+#include "HybridLock.hpp"
+#include "RWSpinLock.hpp"
+#include "PhaseFairRWLock.hpp"
+#include "BigReaderLock.hpp"
+#include "CohortLock.hpp"
+#include "LockBench.hpp"
 
 TASLock tas;
 TTASLock ttas;
 TicketLock tick;
+MCSLock mcs;
+CLHLock clh;
+HybridLock hybrid;
 
 TEST(MutualExclusion, TASLock) {
   unsigned int num1 = 0;
@@ -116,4 +129,231 @@ TEST(MutualExclusion, TicketLock) {unsigned int num1 = 0;
   for (auto &th : threads2)
     th.join();
   EXPECT_EQ(num2, 200000);
-}
\ No newline at end of file
+}
+
+TEST(MutualExclusion, MCSLock) {
+  unsigned int num = 0;
+
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < 20; i++) {
+    threads.push_back(std::thread([&](){
+      for (int i = 0; i < 10000; i++) {
+        if (i % 2) {
+          mcs.lock();
+          num++;
+          mcs.unlock();
+        }
+        else {
+          MCSLock::Guard guard(mcs);
+          num++;
+        }
+      }
+    }));
+  }
+  for (auto &th : threads)
+    th.join();
+  EXPECT_EQ(num, 200000);
+}
+
+TEST(MutualExclusion, CLHLock) {
+  unsigned int num = 0;
+
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < 20; i++) {
+    threads.push_back(std::thread([&](){
+      for (int i = 0; i < 10000; i++) {
+        if (i % 2) {
+          clh.lock();
+          num++;
+          clh.unlock();
+        }
+        else {
+          CLHLock::Guard guard(clh);
+          num++;
+        }
+      }
+    }));
+  }
+  for (auto &th : threads)
+    th.join();
+  EXPECT_EQ(num, 200000);
+}
+
+// a thread holding two queue locks at once, released out of order
+TEST(MutualExclusion, NestedQueueLocks) {
+  MCSLock a, b;
+  CLHLock c, d;
+  unsigned int num = 0;
+
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < 4; i++) {
+    threads.push_back(std::thread([&](){
+      for (int i = 0; i < 10000; i++) {
+        a.lock();
+        b.lock();
+        a.unlock();
+        c.lock();
+        d.lock();
+        c.unlock();
+        num++;
+        d.unlock();
+        b.unlock();
+      }
+    }));
+  }
+  for (auto &th : threads)
+    th.join();
+  EXPECT_EQ(num, 40000);
+}
+
+// with more threads than cores most waiters end up asleep on the futex
+TEST(MutualExclusion, HybridLock) {
+  unsigned int num = 0;
+
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < 4 * (int)std::thread::hardware_concurrency() + 4; i++) {
+    threads.push_back(std::thread([&](){
+      for (int i = 0; i < 10000; i++) {
+        hybrid.lock();
+        num++;
+        if (i % 1000 == 0)
+          std::this_thread::yield();
+        hybrid.unlock();
+      }
+    }));
+  }
+  for (auto &th : threads)
+    th.join();
+  EXPECT_EQ(num, 10000 * threads.size());
+}
+
+TEST(MutualExclusion, CohortLock) {
+  // four emulated nodes with two threads each, so that batches form
+  CohortLock cohort(4, 8);
+  unsigned int num = 0;
+
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < 8; t++) {
+    threads.push_back(std::thread([&, t](){
+      CohortLock::bindThreadToNode(t % 4);
+      for (int i = 0; i < 10000; i++) {
+        cohort.lock();
+        num++;
+        cohort.unlock();
+      }
+    }));
+  }
+  for (auto &th : threads)
+    th.join();
+  EXPECT_EQ(num, 10000 * threads.size());
+}
+
+TEST(CohortLock, SparseNodeIds) {
+  // node1 is offline, node2's CPUs must not fall back to node 0
+  std::string root = testing::TempDir() + "cohort_nodes";
+  std::filesystem::create_directories(root + "/node0");
+  std::filesystem::create_directories(root + "/node2");
+  std::ofstream(root + "/online") << "0,2\n";
+  std::ofstream(root + "/node0/cpulist") << "0-1\n";
+  std::ofstream(root + "/node2/cpulist") << "2-3,6\n";
+
+  NumaTopology topology(root);
+  EXPECT_EQ(topology.nodes(), 3u);
+  EXPECT_EQ(topology.nodeOf(1), 0u);
+  EXPECT_EQ(topology.nodeOf(2), 2u);
+  EXPECT_EQ(topology.nodeOf(6), 2u);
+  EXPECT_EQ(NumaTopology(root + "/missing").nodes(), 1u);
+  std::filesystem::remove_all(root);
+}
+
+// writers keep two counters equal, readers must never see them apart
+template <typename Lock>
+void readersAndWriters() {
+  Lock lock;
+  unsigned int a = 0, b = 0;
+  std::atomic<unsigned int> torn = 0, reads = 0;
+
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < 8; i++) {
+    threads.push_back(std::thread([&, i](){
+      for (int k = 0; k < 10000; k++) {
+        if ((k + i) % 4 == 0) {
+          lock.lock();
+          a++;
+          b++;
+          lock.unlock();
+        }
+        else {
+          lock.lock_shared();
+          if (a != b)
+            torn++;
+          lock.unlock_shared();
+          reads++;
+        }
+      }
+    }));
+  }
+  for (auto &th : threads)
+    th.join();
+  EXPECT_EQ(torn, 0);
+  EXPECT_EQ(a, 20000);
+  EXPECT_EQ(reads, 60000);
+}
+
+TEST(MutualExclusion, RWSpinLock) {
+  readersAndWriters<RWSpinLock>();
+}
+
+TEST(MutualExclusion, PhaseFairRWLock) {
+  readersAndWriters<PhaseFairRWLock>();
+}
+
+TEST(MutualExclusion, BigReaderLock) {
+  readersAndWriters<BigReaderLock>();
+}
+
+TEST(LockBench, Percentiles) {
+  LatencyHistogram latency;
+  for (uint64_t v = 1; v <= 100000; v++)
+    latency.record(v);
+  EXPECT_EQ(latency.count(), 100000u);
+  EXPECT_EQ(latency.max(), 100000u);
+  EXPECT_EQ(latency.percentile(0.00001), 1u);
+  // within the 1/32 resolution of a bucket
+  EXPECT_NEAR(latency.percentile(0.5), 50000, 50000 / 32);
+  EXPECT_NEAR(latency.percentile(0.99), 99000, 99000 / 32);
+  EXPECT_NEAR(latency.percentile(0.999), 99900, 99900 / 32);
+  EXPECT_EQ(latency.percentile(1), 100000u);
+}
+
+TEST(LockBench, LargestValues) {
+  LatencyHistogram latency;
+  latency.record(UINT64_MAX);
+  latency.record(uint64_t(1) << 63);
+  latency.record(uint64_t(1) << 58);
+  EXPECT_EQ(latency.count(), 3u);
+  EXPECT_EQ(latency.max(), UINT64_MAX);
+  EXPECT_EQ(latency.percentile(1), UINT64_MAX);
+  EXPECT_GE(latency.percentile(0.5), uint64_t(1) << 63);
+}
+
+TEST(LockBench, CountsEveryAcquisition) {
+  TicketLock lock;
+  LockBenchConfig cfg;
+  cfg.threads = 4;
+  cfg.duration = std::chrono::milliseconds(50);
+  auto r = runLockBench("tick", lock, cfg);
+  EXPECT_GT(r.acquisitions, 0u);
+  EXPECT_GT(r.fairness, 0.25);
+  EXPECT_LE(r.fairness, 1.0 + 1e-9);
+  EXPECT_LE(r.min_share, 1.0);
+  EXPECT_GE(r.max_share, 1.0);
+  EXPECT_LE(r.p50_ns, r.p99_ns);
+  EXPECT_LE(r.p99_ns, r.max_ns);
+}
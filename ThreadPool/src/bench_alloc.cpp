@@ -0,0 +1,67 @@
+// Heap allocations per submitted task for std::function tasks (the old pool) and for
+// UniqueTask in recycled cells, counted by interposing malloc.
+// usage: bench_alloc [n_threads] [tasks]
+#include "thread_pool.hpp"
+#include "legacy_thread_pool.hpp"
+#include <string>
+
+extern "C" void* __libc_malloc(size_t size);
+
+static std::atomic<uint64_t> mallocs{0};
+
+extern "C" void* malloc(size_t size) {
+    mallocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+static std::atomic<uint64_t> executed;
+
+template <size_t N>
+struct Payload {
+    char bytes[N];
+};
+
+template <typename Pool, typename TaskType, size_t N>
+double allocsPerTask(unsigned n_threads, uint64_t n_tasks) {
+    Pool pool{n_threads};
+    Payload<N> payload{};
+
+    auto submitAll = [&](uint64_t count){
+        executed = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            pool.submit(TaskType([payload](){
+                executed.fetch_add(payload.bytes[0] + 1, std::memory_order_relaxed);
+            }));
+        }
+        while (executed.load(std::memory_order_acquire) != count)
+            std::this_thread::yield();
+    };
+
+    // warms up the inboxes, deques and cell caches
+    submitAll(n_tasks);
+
+    auto before = mallocs.load();
+    submitAll(n_tasks);
+    return double(mallocs.load() - before) / n_tasks;
+}
+
+template <size_t N>
+void row(unsigned n_threads, uint64_t n_tasks) {
+    std::cout << N << ","
+              << allocsPerTask<LegacyThreadPool, std::function<void()>, N>(n_threads, n_tasks) << ","
+              << allocsPerTask<ThreadPool, Task, N>(n_threads, n_tasks) << ","
+              << (Task::storedInline<Payload<N>>() ? "inline" : "heap") << "\n";
+}
+
+int main(int argc, char** argv) {
+    unsigned n_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    uint64_t n_tasks = argc > 2 ? std::stoull(argv[2]) : 100000;
+
+    std::cout << "capture bytes,std::function allocs/task,UniqueTask allocs/task,UniqueTask storage\n";
+    row<8>(n_threads, n_tasks);
+    row<16>(n_threads, n_tasks);
+    row<32>(n_threads, n_tasks);
+    row<TASK_INLINE_SIZE>(n_threads, n_tasks);
+    row<2 * TASK_INLINE_SIZE>(n_threads, n_tasks);
+    return 0;
+}
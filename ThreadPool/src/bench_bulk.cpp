@@ -0,0 +1,64 @@
+// Per-task submit against submitBulk on the echo workload of main.cpp: 10,000 TaskString messages
+// arriving BUFF_SIZE bytes (32 messages) per read, every task writing its message to /dev/null.
+// usage: bench_bulk [n_threads] [messages] [repeats]
+#include "thread_pool.hpp"
+#include "data_samples.hpp"
+#include <chrono>
+#include <string>
+
+enum class Mode { PerTask, OneQueue, AllQueues };
+
+struct Timing {
+    double submit_ms = 0;
+    double total_ms = 0;
+};
+
+Timing run(Mode mode, unsigned n_threads, const std::vector<TaskString>& msgs, size_t per_read, unsigned repeats) {
+    ThreadPool pool{n_threads};
+    Timing timing;
+    std::vector<TaskString> batch;
+    for (unsigned r = 0; r < repeats; r++) {
+        auto st = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < msgs.size(); i += per_read) {
+            auto end = std::min(msgs.size(), i + per_read);
+            batch.assign(msgs.begin() + i, msgs.begin() + end);
+            if (mode == Mode::PerTask) {
+                for (auto& m : batch)
+                    pool.submit(Task(m));
+            }
+            else {
+                pool.submitBulk(batch.begin(), batch.end(), Priority::Normal,
+                                mode == Mode::OneQueue ? BulkSpread::OneQueue : BulkSpread::AllQueues);
+            }
+        }
+        auto submitted = std::chrono::steady_clock::now();
+        pool.waitIdle();
+        auto done = std::chrono::steady_clock::now();
+        timing.submit_ms += std::chrono::duration<double, std::milli>(submitted - st).count() / repeats;
+        timing.total_ms += std::chrono::duration<double, std::milli>(done - st).count() / repeats;
+    }
+    return timing;
+}
+
+int main(int argc, char** argv) {
+    unsigned n_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    size_t messages = argc > 2 ? std::stoull(argv[2]) : 10000;
+    unsigned repeats = argc > 3 ? std::stoul(argv[3]) : 20;
+
+    int sink = open("/dev/null", O_WRONLY);
+    std::vector<TaskString> msgs;
+    for (size_t i = 0; i < messages; i++)
+        msgs.push_back(TaskString(sink, std::to_string(i)));
+
+    std::cout << "mode,messages per submit,submit ms,total ms\n";
+    for (size_t per_read : {size_t(BUFF_SIZE / TASKMSG_SIZE), messages}) {
+        for (auto [name, mode] : {std::pair{"per task", Mode::PerTask},
+                                  std::pair{"bulk one queue", Mode::OneQueue},
+                                  std::pair{"bulk all queues", Mode::AllQueues}}) {
+            auto t = run(mode, n_threads, msgs, per_read, repeats);
+            std::cout << name << "," << per_read << "," << t.submit_ms << "," << t.total_ms << "\n";
+        }
+    }
+    close(sink);
+    return 0;
+}
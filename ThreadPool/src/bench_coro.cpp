@@ -0,0 +1,117 @@
+// Recursive fork-join with coroutines (spawn + co_await) against the future style, where a
+// parent waits in `get()` and keeps its worker busy by running other tasks meanwhile.
+// usage: bench_coro [n_threads] [fib_n] [sort_size] [repeats]
+#include "coroutine.hpp"
+#include <chrono>
+#include <random>
+#include <string>
+
+const int FIB_CUTOFF = 16;
+const size_t SORT_CUTOFF = 4096;
+
+static uint64_t fibSerial(int n) {
+    return n < 2 ? n : fibSerial(n - 1) + fibSerial(n - 2);
+}
+
+static uint64_t fibFutures(ThreadPool& pool, int n) {
+    if (n < FIB_CUTOFF)
+        return fibSerial(n);
+    auto a = pool.submit(fibFutures, std::ref(pool), n - 1);
+    auto b = fibFutures(pool, n - 2);
+    return a.get() + b;
+}
+
+static CoTask<uint64_t> fibCoro(ThreadPool& pool, int n) {
+    if (n < FIB_CUTOFF)
+        co_return fibSerial(n);
+    auto a = spawn(pool, fibCoro(pool, n - 1));
+    auto b = co_await fibCoro(pool, n - 2);
+    co_return co_await a + b;
+}
+
+template <typename It>
+static It partition(It begin, It end) {
+    auto pivot = *(begin + (end - begin) / 2);
+    return std::partition(begin, end, [pivot](int v){ return v < pivot; });
+}
+
+// [begin, mid) < pivot <= [mid, end); an all-equal range would not shrink, so sort it serially
+template <typename It>
+static bool splits(It begin, It mid, It end) {
+    return mid != begin && mid != end;
+}
+
+static void sortFutures(ThreadPool& pool, std::vector<int>::iterator begin, std::vector<int>::iterator end) {
+    if (size_t(end - begin) < SORT_CUTOFF) {
+        std::sort(begin, end);
+        return;
+    }
+    auto mid = partition(begin, end);
+    if (!splits(begin, mid, end)) {
+        std::sort(begin, end);
+        return;
+    }
+    auto left = pool.submit(sortFutures, std::ref(pool), begin, mid);
+    sortFutures(pool, mid, end);
+    left.get();
+}
+
+static CoTask<> sortCoro(ThreadPool& pool, std::vector<int>::iterator begin, std::vector<int>::iterator end) {
+    if (size_t(end - begin) < SORT_CUTOFF) {
+        std::sort(begin, end);
+        co_return;
+    }
+    auto mid = partition(begin, end);
+    if (!splits(begin, mid, end)) {
+        std::sort(begin, end);
+        co_return;
+    }
+    auto left = spawn(pool, sortCoro(pool, begin, mid));
+    co_await sortCoro(pool, mid, end);
+    co_await left;
+}
+
+template <typename F>
+double millis(unsigned repeats, F&& f) {
+    auto st = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < repeats; r++)
+        f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - st).count() / repeats;
+}
+
+int main(int argc, char** argv) {
+    unsigned n_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    int fib_n = argc > 2 ? std::stoi(argv[2]) : 34;
+    size_t sort_size = argc > 3 ? std::stoull(argv[3]) : 2000000;
+    unsigned repeats = argc > 4 ? std::stoul(argv[4]) : 5;
+
+    ThreadPool pool{n_threads};
+    std::cout << "workload,serial ms,futures ms,coroutines ms\n";
+
+    uint64_t sums[3] = {};
+    std::cout << "fib(" << fib_n << ")"
+              << "," << millis(repeats, [&](){ sums[0] = fibSerial(fib_n); })
+              << "," << millis(repeats, [&](){ sums[1] = pool.submit(fibFutures, std::ref(pool), fib_n).get(); })
+              << "," << millis(repeats, [&](){ sums[2] = launch(pool, fibCoro(pool, fib_n)).get(); }) << "\n";
+
+    std::vector<int> input(sort_size), data;
+    std::mt19937 rng(42);
+    for (auto& v : input)
+        v = int(rng());
+    auto fresh = [&](){ data = input; };
+    double serial = 0, futures = 0, coro = 0;
+    for (unsigned r = 0; r < repeats; r++) {
+        fresh();
+        serial += millis(1, [&](){ std::sort(data.begin(), data.end()); });
+        fresh();
+        futures += millis(1, [&](){ pool.submit(sortFutures, std::ref(pool), data.begin(), data.end()).get(); });
+        bool ok = std::is_sorted(data.begin(), data.end());
+        fresh();
+        coro += millis(1, [&](){ launch(pool, sortCoro(pool, data.begin(), data.end())).get(); });
+        if (!ok || !std::is_sorted(data.begin(), data.end()))
+            std::cout << "# not sorted\n";
+    }
+    std::cout << "quicksort " << sort_size << "," << serial / repeats << "," << futures / repeats << "," << coro / repeats << "\n";
+    std::cout << "# fib " << sums[0] << " " << sums[1] << " " << sums[2] << "\n";
+    return 0;
+}
@@ -0,0 +1,74 @@
+// CPU time burnt per task and wake-up latency of the idle strategies on a bursty workload.
+// usage: bench_idle [n_threads] [bursts] [burst_size] [gap_us]
+#include "thread_pool.hpp"
+#include <chrono>
+#include <string>
+#include <sys/resource.h>
+
+static std::atomic<uint64_t> executed;
+static std::atomic<int64_t> wakeup_ns;
+
+static double cpuSeconds() {
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void run(const std::string& name, unsigned n_threads, ThreadPoolOptions opts,
+         unsigned bursts, unsigned burst_size, unsigned gap_us) {
+    executed = 0;
+    wakeup_ns = 0;
+    auto cpu_st = cpuSeconds();
+    auto wall_st = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool{n_threads, opts};
+        for (unsigned b = 0; b < bursts; b++) {
+            // the first task of a burst measures how long a sleeping pool needs to notice it
+            auto submitted = nowNs();
+            pool.submit(Task([submitted](){
+                wakeup_ns.fetch_add(nowNs() - submitted, std::memory_order_relaxed);
+                executed.fetch_add(1, std::memory_order_relaxed);
+            }));
+            for (unsigned i = 1; i < burst_size; i++) {
+                pool.submit(Task([](){
+                    executed.fetch_add(1, std::memory_order_relaxed);
+                }));
+            }
+            while (executed.load(std::memory_order_acquire) != (b + 1) * burst_size)
+                std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+        }
+    }
+    auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_st).count();
+    auto cpu = cpuSeconds() - cpu_st;
+
+    std::cout << name << "," << opts.spin_rounds << "," << opts.yield_rounds << ","
+              << wall << "," << cpu << "," << cpu / (bursts * burst_size) << ","
+              << wakeup_ns / bursts << "\n";
+}
+
+int main(int argc, char** argv) {
+    unsigned n_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    unsigned bursts = argc > 2 ? std::stoul(argv[2]) : 200;
+    unsigned burst_size = argc > 3 ? std::stoul(argv[3]) : 1000;
+    unsigned gap_us = argc > 4 ? std::stoul(argv[4]) : 1000;
+
+    std::cout << "strategy,spin rounds,yield rounds,wall s,cpu s,cpu s/task,avg wake-up ns\n";
+    // never parks, the behaviour before parking was introduced
+    ThreadPoolOptions yield_spin;
+    yield_spin.spin_rounds = 0;
+    yield_spin.yield_rounds = UINT32_MAX;
+    ThreadPoolOptions park_at_once;
+    park_at_once.spin_rounds = 0;
+    park_at_once.yield_rounds = 0;
+
+    run("yield-spin", n_threads, yield_spin, bursts, burst_size, gap_us);
+    run("adaptive", n_threads, {}, bursts, burst_size, gap_us);
+    run("park-at-once", n_threads, park_at_once, bursts, burst_size, gap_us);
+    return 0;
+}
@@ -0,0 +1,83 @@
+// parallel_for / parallel_reduce with lazy binary splitting against static chunking.
+// usage: bench_parallel [n_threads] [matrix_size] [repeats]
+#include "parallel.hpp"
+#include <chrono>
+#include <cmath>
+#include <string>
+
+// the old way: cut [begin, end) into `chunks` equal pieces up front
+template <typename Body>
+void staticFor(ThreadPool& pool, size_t begin, size_t end, size_t chunks, const Body& body) {
+    std::vector<Future<void>> parts;
+    size_t step = (end - begin + chunks - 1) / chunks;
+    for (size_t lo = begin; lo < end; lo += step) {
+        auto hi = std::min(end, lo + step);
+        parts.push_back(pool.submit([lo, hi, &body](){
+            for (auto i = lo; i < hi; i++)
+                body(i);
+        }));
+    }
+    when_all(std::move(parts)).get();
+}
+
+template <typename F>
+double millis(unsigned repeats, F&& f) {
+    auto st = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < repeats; r++)
+        f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - st).count() / repeats;
+}
+
+int main(int argc, char** argv) {
+    unsigned n_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    size_t n = argc > 2 ? std::stoull(argv[2]) : 256;
+    unsigned repeats = argc > 3 ? std::stoul(argv[3]) : 10;
+
+    ThreadPool pool{n_threads};
+    std::vector<double> A(n * n, 1.0), B(n * n, 2.0), C(n * n);
+
+    // rows of an i-k-j matrix product, every row costs the same
+    auto matRow = [&](size_t i){
+        for (size_t j = 0; j < n; j++)
+            C[i * n + j] = 0;
+        for (size_t k = 0; k < n; k++)
+            for (size_t j = 0; j < n; j++)
+                C[i * n + j] += A[i * n + k] * B[k * n + j];
+    };
+    // row i only goes up to the diagonal, so equal chunks get very unequal work
+    auto triRow = [&](size_t i){
+        for (size_t k = 0; k <= i; k++)
+            for (size_t j = 0; j < n; j++)
+                C[i * n + j] += A[i * n + k] * B[k * n + j];
+    };
+    std::vector<double> small(1000, 1.0);
+    auto smallBody = [&](size_t i){ small[i] = std::sqrt(small[i] + i); };
+
+    std::cout << "workload,sequential ms,static(n_threads) ms,static(4*n_threads) ms,lazy ms\n";
+    auto row = [&](const std::string& name, size_t end, size_t grain, auto& body){
+        std::cout << name << ","
+                  << millis(repeats, [&](){ for (size_t i = 0; i < end; i++) body(i); }) << ","
+                  << millis(repeats, [&](){ staticFor(pool, 0, end, n_threads, body); }) << ","
+                  << millis(repeats, [&](){ staticFor(pool, 0, end, 4 * n_threads, body); }) << ","
+                  << millis(repeats, [&](){ parallel_for(pool, size_t(0), end, grain, body); }) << "\n";
+    };
+    row("matmul rows", n, 1, matRow);
+    row("triangular rows", n, 1, triRow);
+    row("1000 sqrt", small.size(), 64, smallBody);
+
+    double seq_sum = 0;
+    auto seq = millis(repeats, [&](){
+        seq_sum = 0;
+        for (size_t i = 0; i < 10000000; i++)
+            seq_sum += std::sqrt(double(i));
+    });
+    double par_sum = 0;
+    auto par = millis(repeats, [&](){
+        par_sum = parallel_reduce(pool, size_t(0), size_t(10000000), size_t(4096), 0.0,
+            [](size_t i){ return std::sqrt(double(i)); },
+            [](double a, double b){ return a + b; });
+    });
+    std::cout << "reduce sqrt 1e7," << seq << ",,," << par << "\n";
+    std::cout << "# sums " << seq_sum << " " << par_sum << "\n";
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Queueing latency of latency-sensitive "request" tasks mixed into a flood of background
+// tasks, with everything in one lane and with requests in the High lane (and with deadlines).
+// usage: bench_priority [n_threads] [background_tasks] [requests] [task_us]
+#include "thread_pool.hpp"
+#include <chrono>
+#include <string>
+
+
+static void busyFor(std::chrono::microseconds us) {
+    auto until = std::chrono::steady_clock::now() + us;
+    while (std::chrono::steady_clock::now() < until)
+        ;
+}
+
+enum class Mode { SingleLane, HighLane, Deadline };
+
+void run(const std::string& name, Mode mode, unsigned n_threads, unsigned background, unsigned requests, unsigned task_us) {
+    ThreadPoolOptions opts;
+    opts.track_latency = true;
+    ThreadPool pool{n_threads, opts};
+
+    auto body = [task_us](){
+        busyFor(std::chrono::microseconds(task_us));
+    };
+
+    // a request every `every` background tasks, while the backlog keeps growing
+    unsigned every = std::max(1u, background / std::max(1u, requests));
+    for (unsigned i = 0, r = 0; i < background; i++) {
+        pool.submit(Task(body), Priority::Normal);
+        if (i % every == 0 && r < requests) {
+            r++;
+            if (mode == Mode::SingleLane)
+                pool.submit(Task(body), Priority::Normal);
+            else if (mode == Mode::HighLane)
+                pool.submit(Task(body), Priority::High);
+            else
+                pool.submit(Task(body), Priority::High, std::chrono::steady_clock::now() + std::chrono::microseconds(task_us));
+        }
+    }
+    pool.waitIdle();
+
+    // in single lane mode the requests are indistinguishable, so report both lanes as they are
+    auto high = pool.queueLatency(Priority::High);
+    auto normal = pool.queueLatency(Priority::Normal);
+    std::cout << name << ","
+              << high.count << "," << high.p50_ns / 1000 << "," << high.p99_ns / 1000 << ","
+              << normal.count << "," << normal.p50_ns / 1000 << "," << normal.p99_ns / 1000 << "\n";
+}
+
+int main(int argc, char** argv) {
+    unsigned n_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    unsigned background = argc > 2 ? std::stoul(argv[2]) : 20000;
+    unsigned requests = argc > 3 ? std::stoul(argv[3]) : 200;
+    unsigned task_us = argc > 4 ? std::stoul(argv[4]) : 20;
+
+    std::cout << "mode,high tasks,high p50 us,high p99 us,normal tasks,normal p50 us,normal p99 us\n";
+    run("single lane", Mode::SingleLane, n_threads, background, requests, task_us);
+    run("high lane", Mode::HighLane, n_threads, background, requests, task_us);
+    run("high lane + deadline", Mode::Deadline, n_threads, background, requests, task_us);
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Throughput of the lock-free work-stealing queues against the old mutex + std::deque pool.
+// usage: bench_queue [max_threads] [tasks]
+#include "thread_pool.hpp"
+#include "legacy_thread_pool.hpp"
+#include <chrono>
+#include <string>
+
+static std::atomic<uint64_t> executed;
+
+// a plain lambda would pick the future-returning `ThreadPool::submit`
+template <typename Pool>
+struct TaskOf {
+    using type = Task;
+};
+
+template <>
+struct TaskOf<LegacyThreadPool> {
+    using type = std::function<void()>;
+};
+
+static void waitFor(uint64_t n) {
+    while (executed.load(std::memory_order_acquire) != n)
+        std::this_thread::yield();
+}
+
+// every task is submitted from the main thread
+template <typename Pool>
+double externalSubmit(unsigned n_threads, uint64_t n_tasks) {
+    Pool pool{n_threads};
+    executed = 0;
+
+    auto st = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n_tasks; i++) {
+        pool.submit(typename TaskOf<Pool>::type([](){
+            executed.fetch_add(1, std::memory_order_relaxed);
+        }));
+    }
+    waitFor(n_tasks);
+    auto end = std::chrono::steady_clock::now();
+
+    return n_tasks / std::chrono::duration<double>(end - st).count();
+}
+
+// a few roots, each submitting its subtasks from a worker thread
+template <typename Pool>
+double workerSubmit(unsigned n_threads, uint64_t n_tasks) {
+    const uint64_t FANOUT = 1000;
+    const uint64_t roots = n_tasks / FANOUT;
+    Pool pool{n_threads};
+    executed = 0;
+
+    auto st = std::chrono::steady_clock::now();
+    for (uint64_t r = 0; r < roots; r++) {
+        pool.submit(typename TaskOf<Pool>::type([FANOUT](){
+            auto pool = Pool::current();
+            for (uint64_t k = 0; k < FANOUT; k++) {
+                pool->submit(typename TaskOf<Pool>::type([](){
+                    executed.fetch_add(1, std::memory_order_relaxed);
+                }));
+            }
+        }));
+    }
+    waitFor(roots * FANOUT);
+    auto end = std::chrono::steady_clock::now();
+
+    return roots * FANOUT / std::chrono::duration<double>(end - st).count();
+}
+
+int main(int argc, char** argv) {
+    unsigned max_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    uint64_t n_tasks = argc > 2 ? std::stoull(argv[2]) : 200000;
+
+    std::cout << "threads,workload,legacy tasks/s,chase-lev tasks/s\n";
+    for (unsigned n = 1; n <= max_threads; n++) {
+        std::cout << n << ",external,"
+                  << externalSubmit<LegacyThreadPool>(n, n_tasks) << ","
+                  << externalSubmit<ThreadPool>(n, n_tasks) << "\n";
+        std::cout << n << ",worker,"
+                  << workerSubmit<LegacyThreadPool>(n, n_tasks) << ","
+                  << workerSubmit<ThreadPool>(n, n_tasks) << "\n";
+    }
+    return 0;
+}
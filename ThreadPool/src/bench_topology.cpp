@@ -0,0 +1,58 @@
+// Random victims against the topology-aware steal order on a steal-heavy workload whose
+// subtasks read memory first touched by their parent, and where the steals landed.
+// usage: bench_topology [n_threads] [roots] [fanout]
+#include "thread_pool.hpp"
+#include <chrono>
+#include <numeric>
+#include <string>
+
+static std::atomic<uint64_t> checksum;
+
+const size_t SLICE = 4096 / sizeof(uint64_t);
+
+void run(const std::string& name, unsigned n_threads, bool topology_aware, uint64_t roots, uint64_t fanout) {
+    ThreadPoolOptions opts;
+    opts.topology_aware = topology_aware;
+
+    auto st = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool{n_threads, opts};
+        for (uint64_t r = 0; r < roots; r++) {
+            pool.submit(Task([fanout](){
+                auto data = std::make_shared<std::vector<uint64_t>>(SLICE * fanout);
+                std::iota(data->begin(), data->end(), 0);
+                auto pool = ThreadPool::current();
+                for (uint64_t k = 0; k < fanout; k++) {
+                    pool->submit(Task([data, k](){
+                        auto begin = data->begin() + k * SLICE;
+                        checksum.fetch_add(std::accumulate(begin, begin + SLICE, uint64_t(0)), std::memory_order_relaxed);
+                    }));
+                }
+            }));
+        }
+        pool.waitIdle();
+
+        auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - st).count();
+        auto steals = pool.stealsByLevel();
+        std::cout << name << "," << roots * fanout / secs;
+        for (auto s : steals)
+            std::cout << "," << s;
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    unsigned n_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    uint64_t roots = argc > 2 ? std::stoull(argv[2]) : 256;
+    uint64_t fanout = argc > 3 ? std::stoull(argv[3]) : 64;
+
+    auto topo = CpuTopology::detect();
+    std::cout << "# cpu,core,l3,node in placement order\n";
+    for (auto& c : topo.cpus)
+        std::cout << "# " << c.cpu << "," << c.core << "," << c.l3 << "," << c.node << "\n";
+
+    std::cout << "steal order,tasks/s,smt steals,cache steals,node steals,remote steals\n";
+    run("random", n_threads, false, roots, fanout);
+    run("topology", n_threads, true, roots, fanout);
+    return 0;
+}
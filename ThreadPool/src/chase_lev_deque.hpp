@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/// @brief Single-owner work-stealing deque (Chase & Lev, with the C11 orderings from
+/// Le, Pop, Cohen, Zappa Nardelli "Correct and Efficient Work-Stealing for Weak Memory Models").
+///
+/// The owning thread calls `push` and `pop` at the bottom end and never takes a lock;
+/// any other thread may call `steal`, which takes from the top end with a single CAS.
+/// Elements are copied bitwise by thieves before their CAS is known to succeed, so `T`
+/// has to be trivially copyable (in the pool it is a pointer to a task).
+template <typename T>
+class ChaseLevDeque {
+        static_assert(std::is_trivially_copyable_v<T>, "ChaseLevDeque requires trivially copyable elements");
+
+        struct Array {
+            const int64_t capacity;
+            const int64_t mask;
+            std::unique_ptr<std::atomic<T>[]> slots;
+
+            explicit Array(int64_t capacity_)
+                : capacity(capacity_), mask(capacity_ - 1), slots(new std::atomic<T>[capacity_]) {}
+
+            T get(int64_t i) const {
+                return slots[i & mask].load(std::memory_order_relaxed);
+            }
+
+            void put(int64_t i, T x) {
+                slots[i & mask].store(x, std::memory_order_relaxed);
+            }
+
+            Array* grow(int64_t b, int64_t t) const {
+                auto a = new Array(capacity * 2);
+                for (auto i = t; i < b; i++)
+                    a->put(i, get(i));
+                return a;
+            }
+        };
+
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+        alignas(64) std::atomic<Array*> array;
+
+        // thieves may still read from an array the owner has replaced, so old arrays
+        // are kept until the deque itself dies; the total is bounded by 2x the largest array
+        std::vector<std::unique_ptr<Array>> retired;
+
+    public:
+        /// @param capacity initial number of slots, rounded up to a power of two
+        explicit ChaseLevDeque(int64_t capacity = 256) {
+            int64_t cap = 1;
+            while (cap < capacity)
+                cap <<= 1;
+            array.store(new Array(cap), std::memory_order_relaxed);
+        }
+
+        ChaseLevDeque(const ChaseLevDeque&) = delete;
+        ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+        ~ChaseLevDeque() {
+            delete array.load(std::memory_order_relaxed);
+        }
+
+        /// Owner only.
+        void push(T x) {
+            auto b = bottom.load(std::memory_order_relaxed);
+            auto t = top.load(std::memory_order_acquire);
+            auto a = array.load(std::memory_order_relaxed);
+
+            if (b - t > a->capacity - 1) {
+                auto bigger = a->grow(b, t);
+                retired.emplace_back(a);
+                array.store(bigger, std::memory_order_release);
+                a = bigger;
+            }
+            a->put(b, x);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        /// Owner only. Pushes `xs[0..n)` behind a single release fence, `xs[n - 1]` ends up at the bottom.
+        void pushBulk(const T* xs, size_t n) {
+            auto b = bottom.load(std::memory_order_relaxed);
+            auto t = top.load(std::memory_order_acquire);
+            auto a = array.load(std::memory_order_relaxed);
+
+            while (b - t + int64_t(n) > a->capacity) {
+                auto bigger = a->grow(b, t);
+                retired.emplace_back(a);
+                array.store(bigger, std::memory_order_release);
+                a = bigger;
+            }
+            for (size_t i = 0; i < n; i++)
+                a->put(b + int64_t(i), xs[i]);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + int64_t(n), std::memory_order_relaxed);
+        }
+
+        /// Owner only. Takes the most recently pushed element.
+        bool pop(T& x) {
+            auto b = bottom.load(std::memory_order_relaxed) - 1;
+            auto a = array.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto t = top.load(std::memory_order_relaxed);
+
+            if (t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            x = a->get(b);
+            if (t < b)
+                return true;
+
+            // the last element, race against thieves for it
+            bool won = top.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        /// Any thread. Takes the oldest element; fails if the deque is empty or another
+        /// thread won the race for the same element.
+        bool steal(T& x) {
+            auto t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto b = bottom.load(std::memory_order_acquire);
+
+            if (t >= b)
+                return false;
+
+            auto a = array.load(std::memory_order_acquire);
+            x = a->get(t);
+            return top.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        /// Approximate number of elements, exact only when called by the owner with no thieves around.
+        int64_t size() const {
+            auto b = bottom.load(std::memory_order_relaxed);
+            auto t = top.load(std::memory_order_relaxed);
+            return b > t ? b - t : 0;
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+};
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "thread_pool.hpp"
+
+template <typename T>
+class CoTask;
+
+/// State every `CoTask` promise shares: who to resume once the body is done and its exception.
+class CoPromiseBase {
+        // `continuation` holds this once the coroutine has finished
+        static inline char finished_tag;
+
+    public:
+        // the awaiting coroutine's address, nullptr while nobody awaits yet
+        std::atomic<void*> continuation{nullptr};
+        std::exception_ptr error;
+
+        static void* finished() {
+            return &finished_tag;
+        }
+
+        /// Lazy: the body runs when the task is awaited or started on a pool.
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept {
+                return false;
+            }
+
+            // symmetric transfer to the awaiter, so chains of awaits never grow the stack
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+                void* awaiting = h.promise().continuation.exchange(finished(), std::memory_order_acq_rel);
+                return awaiting ? std::coroutine_handle<>::from_address(awaiting) : std::noop_coroutine();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+
+        void unhandled_exception() {
+            error = std::current_exception();
+            if (auto pool = ThreadPool::current())
+                pool->noteTaskError();
+        }
+
+        /// For a started task whose first resumption was dropped by a cancelling shutdown:
+        /// finishes it with `TaskCancelled` without running the body.
+        void cancel() {
+            error = std::make_exception_ptr(TaskCancelled());
+            void* awaiting = continuation.exchange(finished(), std::memory_order_acq_rel);
+            if (awaiting)
+                std::coroutine_handle<>::from_address(awaiting).resume();
+        }
+};
+
+template <typename T>
+class CoPromise : public CoPromiseBase {
+    public:
+        std::optional<T> value;
+
+        CoTask<T> get_return_object();
+
+        template <typename U>
+        void return_value(U&& v) {
+            value.emplace(std::forward<U>(v));
+        }
+
+        T result() {
+            if (error)
+                std::rethrow_exception(error);
+            return std::move(*value);
+        }
+};
+
+template <>
+class CoPromise<void> : public CoPromiseBase {
+    public:
+        CoTask<void> get_return_object();
+
+        void return_void() {}
+
+        void result() {
+            if (error)
+                std::rethrow_exception(error);
+        }
+};
+
+/// @brief Lazily started coroutine producing a `T`, for code that runs on a `ThreadPool` and waits
+/// by `co_await` instead of blocking its worker.
+///
+/// `co_await task` runs a task that has not been started in place, transferring control to it and
+/// back without growing the stack. `spawn` starts one on the pool instead, so it runs in parallel
+/// with its parent until the parent awaits it; whichever finishes last resumes the parent.
+/// Exceptions travel to the awaiter. A started task has to be awaited before it is destroyed,
+/// the `CoTask` owns the coroutine frame. `launch` bridges to blocking code through a `Future`.
+template <typename T = void>
+class CoTask {
+    public:
+        using promise_type = CoPromise<T>;
+        using Handle = std::coroutine_handle<promise_type>;
+
+    private:
+        Handle h;
+        bool started = false;
+
+        struct Awaiter {
+            Handle h;
+            bool started;
+
+            bool await_ready() const noexcept {
+                return started && h.promise().continuation.load(std::memory_order_acquire) == CoPromiseBase::finished();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                if (!started) {
+                    h.promise().continuation.store(awaiting.address(), std::memory_order_relaxed);
+                    return h;
+                }
+                void* expected = nullptr;
+                if (h.promise().continuation.compare_exchange_strong(
+                        expected, awaiting.address(), std::memory_order_acq_rel, std::memory_order_acquire))
+                    return std::noop_coroutine();
+                // finished in the meantime
+                return awaiting;
+            }
+
+            T await_resume() {
+                return h.promise().result();
+            }
+        };
+
+    public:
+        CoTask() = default;
+        explicit CoTask(Handle h_) : h(h_) {}
+
+        CoTask(CoTask&& other) noexcept : h(std::exchange(other.h, nullptr)), started(other.started) {}
+
+        CoTask& operator=(CoTask&& other) noexcept {
+            if (this != &other) {
+                if (h)
+                    h.destroy();
+                h = std::exchange(other.h, nullptr);
+                started = other.started;
+            }
+            return *this;
+        }
+
+        CoTask(const CoTask&) = delete;
+        CoTask& operator=(const CoTask&) = delete;
+
+        ~CoTask() {
+            if (h)
+                h.destroy();
+        }
+
+        bool valid() const {
+            return h != nullptr;
+        }
+
+        Awaiter operator co_await() const noexcept {
+            return Awaiter{h, started};
+        }
+
+        /// Queues the first resumption on `pool`; the body then runs in parallel with the caller.
+        void start(ThreadPool& pool) {
+            started = true;
+            auto cancel = DropGuard([h = h](){ h.promise().cancel(); });
+            pool.submit(Task([h = h, cancel = std::move(cancel)]() mutable {
+                cancel.disarm();
+                h.resume();
+            }));
+        }
+};
+
+template <typename T>
+CoTask<T> CoPromise<T>::get_return_object() {
+    return CoTask<T>(CoTask<T>::Handle::from_promise(*this));
+}
+
+inline CoTask<void> CoPromise<void>::get_return_object() {
+    return CoTask<void>(CoTask<void>::Handle::from_promise(*this));
+}
+
+/// Starts `task` on `pool` and hands it back, to be awaited later.
+template <typename T>
+CoTask<T> spawn(ThreadPool& pool, CoTask<T> task) {
+    task.start(pool);
+    return task;
+}
+
+/// Fire-and-forget coroutine, its frame frees itself at the end. Used by `launch` only.
+struct DetachedCoroutine {
+    struct promise_type {
+        DetachedCoroutine get_return_object() {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+template <typename T>
+DetachedCoroutine launchInto(ThreadPool& pool, CoTask<T> task, std::shared_ptr<FutureState<T>> state) {
+    try {
+        co_await pool.schedule();
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+            state->run([](){});
+        }
+        else {
+            T value = co_await task;
+            state->run([&](){ return std::move(value); });
+        }
+    }
+    catch (...) {
+        state->setException(std::current_exception());
+    }
+}
+
+/// @brief Runs `task` on `pool` and returns the future of its result, for threads that
+/// cannot `co_await` or to combine it with `then` and `when_all`.
+template <typename T>
+Future<T> launch(ThreadPool& pool, CoTask<T> task) {
+    auto state = std::make_shared<FutureState<T>>(&pool);
+    launchInto(pool, std::move(task), state);
+    return Future<T>(std::move(state));
+}
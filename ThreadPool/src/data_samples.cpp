@@ -3,33 +3,39 @@
 #include <stdlib.h>
 #include <exception>
 #include <string.h>
+#include <system_error>
 
-static char buff[BUFF_SIZE];
-static int nbytes = 0;
-
-void SubmitTasksFromFile(int fd, ThreadPool& pool) {
-    nbytes = read(fd, buff, BUFF_SIZE);
-    std::cout << "OK" << nbytes << "\n"; 
-    if (errno) {
-        if (errno == EAGAIN) {
-            return;
-        }
-        else {
-            perror("WHY");
-            std::system_error err(std::error_code(), "Bad fd read");
-            throw std::system_error(err);
+bool SubmitTasksFromFile(int fd, ThreadPool& pool, std::string& pending) {
+    // on the stack: callbacks of different fds run at the same time
+    char buff[BUFF_SIZE];
+    bool open = true;
+    while (true) {
+        auto nbytes = read(fd, buff, BUFF_SIZE);
+        if (nbytes > 0) {
+            pending.append(buff, nbytes);
+            continue;
         }
+        if (nbytes == 0)
+            open = false;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+            throw std::system_error(errno, std::system_category(), "Bad fd read");
+        break;
     }
-    auto buff_local_ptr = buff;
-    while (buff_local_ptr[0] != SPCL_SYMB) {
-        buff_local_ptr = buff_local_ptr + 1;
-    }
-    for (int i = 0; i < nbytes/TASKMSG_SIZE; i++) {
-        auto tsk_str = TaskString::taskFromMsg(std::string(buff_local_ptr, TASKMSG_SIZE));
-        buff_local_ptr = buff_local_ptr + TASKMSG_SIZE;
-        pool.submit(tsk_str);
+
+    std::vector<TaskString> tasks;
+    size_t pos = 0;
+    while (pending.size() - pos >= TASKMSG_SIZE) {
+        // skip to the next message start, as the old reader did
+        if (pending[pos] != SPCL_SYMB) {
+            pos++;
+            continue;
+        }
+        tasks.push_back(TaskString::taskFromMsg(pending.substr(pos, TASKMSG_SIZE)));
+        pos += TASKMSG_SIZE;
     }
-    return;
+    pending.erase(0, pos);
+    pool.submitBulk(tasks.begin(), tasks.end());
+    return open;
 }
 
 TaskString::TaskString(int dest, std::string msg) {
@@ -39,18 +45,21 @@ TaskString::TaskString(int dest, std::string msg) {
 }
 
 TaskString::operator Task() {
-    return [=]() {
-        write(*(int*)(s + 1), s + 2 * sizeof(int), TASKMSG_SIZE - 2 * sizeof(int));
+    // a copy of the message, the TaskString itself is usually gone by the time the task runs
+    return [*this]() {
+        auto text = s + sizeof(int) + 1;
+        write(*(int*)(s + 1), text, strnlen(text, TASKMSG_SIZE - sizeof(int) - 1));
     };
 }
 
+// the destination fd is binary and usually contains zero bytes, so always all TASKMSG_SIZE bytes
 std::string TaskString::taskToMsg() {
-    return s;
+    return std::string(s, TASKMSG_SIZE);
 }
 
 TaskString TaskString::taskFromMsg(std::string msg) {
-    TaskString ts;
-    strncpy(ts.s, msg.c_str(), TASKMSG_SIZE);
-    return std::move(ts);
+    TaskString ts{};
+    memcpy(ts.s, msg.data(), std::min<size_t>(msg.size(), TASKMSG_SIZE));
+    return ts;
 }
 
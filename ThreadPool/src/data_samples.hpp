@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <string>
 #include <vector>
 #include <unistd.h>
 #include <fcntl.h>
@@ -24,4 +25,7 @@ class TaskString {
         operator Task();
 };
 
-void SubmitTasksFromFile(int fd, ThreadPool& pool);
+// Reads whatever `fd` has without blocking and submits a task per complete message in one batch.
+// `pending` keeps a message split between two reads for the next call with the same fd.
+// Returns false once the writing end is closed.
+bool SubmitTasksFromFile(int fd, ThreadPool& pool, std::string& pending);
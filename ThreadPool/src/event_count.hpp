@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/// @brief Lets threads sleep until "something may have changed" without a lost-wakeup race.
+///
+/// A waiter announces itself with `prepareWait`, re-checks its condition and only then
+/// either `cancelWait`s or `commitWait`s. A notifier first makes its change visible and then
+/// calls `notify`, which costs a fence and a load while nobody is waiting.
+class EventCount {
+        std::atomic<uint32_t> epoch{0};
+        std::atomic<uint32_t> waiters{0};
+
+        static void futexWait(std::atomic<uint32_t>* addr, uint32_t expected) {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+        }
+
+        static void futexWake(std::atomic<uint32_t>* addr, int count) {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+        }
+
+    public:
+        uint32_t prepareWait() {
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return epoch.load(std::memory_order_acquire);
+        }
+
+        void cancelWait() {
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        /// Sleeps until a `notify` newer than the matching `prepareWait`.
+        void commitWait(uint32_t key) {
+            while (epoch.load(std::memory_order_acquire) == key)
+                futexWait(&epoch, key);
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        /// Wakes at most one sleeping thread, false if nobody was waiting.
+        bool notify() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiters.load(std::memory_order_relaxed) == 0)
+                return false;
+            epoch.fetch_add(1, std::memory_order_release);
+            futexWake(&epoch, 1);
+            return true;
+        }
+
+        /// For notifiers whose check is too costly to make while nobody is waiting:
+        /// a waiter that is not seen here will see the notifier's earlier changes.
+        bool hasWaiters() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return waiters.load(std::memory_order_relaxed) != 0;
+        }
+
+        void notifyAll() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            epoch.fetch_add(1, std::memory_order_release);
+            futexWake(&epoch, INT_MAX);
+        }
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
+#include "task.hpp"
+
+class ThreadPool;
+
+/// Completion flag, error slot and continuation list shared by every `FutureState<R>`.
+/// The parts that talk to the pool are defined in thread_pool.cpp.
+class FutureStateBase {
+    protected:
+        ThreadPool* const pool;
+        std::mutex m;
+        std::condition_variable cv;
+        std::atomic<bool> is_ready{false};
+        std::exception_ptr error;
+        std::vector<Task> continuations;
+
+        /// Publishes the result and schedules the continuations. When called on a worker
+        /// of `pool` they go to that worker's own deque and run next, while the result is hot.
+        void markReady();
+
+        /// Counts the exception `run` caught in the stats of the worker it ran on.
+        void noteError();
+
+    public:
+        explicit FutureStateBase(ThreadPool* pool_) : pool(pool_) {}
+
+        FutureStateBase(const FutureStateBase&) = delete;
+        FutureStateBase& operator=(const FutureStateBase&) = delete;
+
+        ThreadPool* owner() const {
+            return pool;
+        }
+
+        bool ready() const {
+            return is_ready.load(std::memory_order_acquire);
+        }
+
+        /// Blocks until ready; a worker of `pool` runs other tasks meanwhile instead of sleeping.
+        void wait();
+
+        /// Schedules `t` on the pool once ready, right away if it already is.
+        void onReady(Task t);
+
+        void setException(std::exception_ptr e) {
+            error = std::move(e);
+            markReady();
+        }
+
+        /// Valid once ready.
+        const std::exception_ptr& exception() const {
+            return error;
+        }
+};
+
+template <typename R>
+class FutureState : public FutureStateBase {
+        std::optional<R> result;
+
+    public:
+        using FutureStateBase::FutureStateBase;
+
+        template <typename F>
+        void run(F&& f) {
+            try {
+                result.emplace(f());
+            }
+            catch (...) {
+                error = std::current_exception();
+                noteError();
+            }
+            markReady();
+        }
+
+        /// Valid once ready and without an exception.
+        R& value() {
+            return *result;
+        }
+};
+
+template <>
+class FutureState<void> : public FutureStateBase {
+    public:
+        using FutureStateBase::FutureStateBase;
+
+        template <typename F>
+        void run(F&& f) {
+            try {
+                f();
+            }
+            catch (...) {
+                error = std::current_exception();
+                noteError();
+            }
+            markReady();
+        }
+
+        void value() {}
+};
+
+/// @brief Producing side of a future, owned by the task that computes it.
+/// Destroyed before it ran (a cancelling shutdown dropped the task), it fails the future with `TaskCancelled`.
+template <typename R>
+class Promise {
+        std::shared_ptr<FutureState<R>> state;
+
+    public:
+        explicit Promise(std::shared_ptr<FutureState<R>> state_) : state(std::move(state_)) {}
+
+        Promise(Promise&&) noexcept = default;
+        Promise& operator=(Promise&&) = delete;
+
+        ~Promise() {
+            if (state)
+                state->setException(std::make_exception_ptr(TaskCancelled()));
+        }
+
+        template <typename F>
+        void run(F&& f) {
+            auto s = std::move(state);
+            s->run(std::forward<F>(f));
+        }
+
+        void setException(std::exception_ptr e) {
+            auto s = std::move(state);
+            s->setException(std::move(e));
+        }
+};
+
+template <typename F, typename R>
+struct ContinuationResult {
+    using type = std::invoke_result_t<std::decay_t<F>, R>;
+};
+
+template <typename F>
+struct ContinuationResult<F, void> {
+    using type = std::invoke_result_t<std::decay_t<F>>;
+};
+
+/// @brief Result of a task submitted to a `ThreadPool`.
+///
+/// A future has a single consumer: its value is taken either by one `get()` or by one `then()`,
+/// after which the future is no longer `valid()`. Destroying a future never blocks.
+template <typename R>
+class Future {
+        template <typename>
+        friend class Future;
+
+        std::shared_ptr<FutureState<R>> state;
+
+    public:
+        Future() = default;
+        explicit Future(std::shared_ptr<FutureState<R>> state_) : state(std::move(state_)) {}
+
+        bool valid() const {
+            return state != nullptr;
+        }
+
+        bool ready() const {
+            return state->ready();
+        }
+
+        void wait() const {
+            state->wait();
+        }
+
+        /// Waits for the result and returns it, rethrows if the task threw.
+        R get() {
+            auto s = std::move(state);
+            s->wait();
+            if (s->exception())
+                std::rethrow_exception(s->exception());
+            if constexpr (!std::is_void_v<R>)
+                return std::move(s->value());
+        }
+
+        /// @brief Runs `f` with the result as a new pool task once this future is ready.
+        /// If the task threw, `f` is skipped and the exception is passed on to the returned future.
+        template <typename F>
+        Future<typename ContinuationResult<F, R>::type> then(F&& f) {
+            using Next = typename ContinuationResult<F, R>::type;
+
+            auto prev = std::move(state);
+            auto next_state = std::make_shared<FutureState<Next>>(prev->owner());
+            auto raw_prev = prev.get();
+            raw_prev->onReady([prev = std::move(prev), next = Promise<Next>(next_state), f = std::forward<F>(f)]() mutable {
+                if (prev->exception()) {
+                    next.setException(prev->exception());
+                    return;
+                }
+                if constexpr (std::is_void_v<R>)
+                    next.run(f);
+                else
+                    next.run([&](){ return f(std::move(prev->value())); });
+            });
+            return Future<Next>(std::move(next_state));
+        }
+
+        template <typename T>
+        friend Future<std::vector<T>> when_all(std::vector<Future<T>> futures);
+        friend Future<void> when_all(std::vector<Future<void>> futures);
+};
+
+/// @brief Future of all results in the order of `futures`, completed by whichever input finishes
+/// last, so nobody blocks while waiting. The first exception among the inputs is passed on.
+template <typename T>
+Future<std::vector<T>> when_all(std::vector<Future<T>> futures) {
+    struct Join {
+        std::vector<std::optional<T>> results;
+        std::atomic<size_t> left;
+        std::mutex m;
+        std::exception_ptr error;
+        std::shared_ptr<FutureState<std::vector<T>>> out;
+
+        Join(size_t n, std::shared_ptr<FutureState<std::vector<T>>> out_) : results(n), left(n), out(std::move(out_)) {}
+
+        // one input is done, the last one completes `out`
+        void arrive(std::exception_ptr e) {
+            if (e) {
+                auto lg = std::lock_guard(m);
+                if (!error)
+                    error = std::move(e);
+            }
+            if (left.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+            if (error) {
+                out->setException(error);
+                return;
+            }
+            out->run([&](){
+                std::vector<T> all;
+                all.reserve(results.size());
+                for (auto& r : results)
+                    all.push_back(std::move(*r));
+                return all;
+            });
+        }
+    };
+
+    ThreadPool* pool = futures.empty() ? nullptr : futures[0].state->owner();
+    auto out = std::make_shared<FutureState<std::vector<T>>>(pool);
+    if (futures.empty()) {
+        out->run([](){ return std::vector<T>{}; });
+        return Future<std::vector<T>>(std::move(out));
+    }
+
+    auto join = std::make_shared<Join>(futures.size(), out);
+    for (size_t i = 0; i < futures.size(); i++) {
+        auto in = std::move(futures[i].state);
+        auto raw_in = in.get();
+        auto cancel = DropGuard([join](){ join->arrive(std::make_exception_ptr(TaskCancelled())); });
+        raw_in->onReady([i, in = std::move(in), join, cancel = std::move(cancel)]() mutable {
+            cancel.disarm();
+            if (in->exception()) {
+                join->arrive(in->exception());
+                return;
+            }
+            join->results[i].emplace(std::move(in->value()));
+            join->arrive(nullptr);
+        });
+    }
+    return Future<std::vector<T>>(std::move(out));
+}
+
+Future<void> when_all(std::vector<Future<void>> futures);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+struct LatencyStats {
+    uint64_t count = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+/// @brief Log-linear histogram of nanosecond values: every power of two is split into
+/// 2^SUB_BITS buckets, so a reported percentile is at most 12.5% above the true value.
+///
+/// Meant to have a single writer (one per worker) and any number of readers merging snapshots,
+/// so `record` is a relaxed load and store rather than a locked add.
+class LatencyHistogram {
+    public:
+        static constexpr unsigned SUB_BITS = 3;
+        static constexpr unsigned SUB_BUCKETS = 1u << SUB_BITS;
+        static constexpr unsigned BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+        static unsigned bucketOf(uint64_t v) {
+            if (v < SUB_BUCKETS)
+                return unsigned(v);
+            unsigned exp = 63 - __builtin_clzll(v);
+            unsigned sub = unsigned(v >> (exp - SUB_BITS)) & (SUB_BUCKETS - 1);
+            return ((exp - SUB_BITS + 1) << SUB_BITS) + sub;
+        }
+
+        /// the largest value falling into bucket `b`
+        static uint64_t bucketUpper(unsigned b) {
+            if (b < SUB_BUCKETS)
+                return b;
+            unsigned exp = (b >> SUB_BITS) + SUB_BITS - 1;
+            uint64_t width = uint64_t(1) << (exp - SUB_BITS);
+            return (uint64_t(1) << exp) + (b & (SUB_BUCKETS - 1)) * width + width - 1;
+        }
+
+        void record(uint64_t v) {
+            auto& c = counts[bucketOf(v)];
+            c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (v > max.load(std::memory_order_relaxed))
+                max.store(v, std::memory_order_relaxed);
+        }
+
+        /// Adds this histogram's counts to `merged` (BUCKETS long) and returns its maximum.
+        uint64_t mergeInto(std::vector<uint64_t>& merged) const {
+            merged.resize(BUCKETS, 0);
+            for (unsigned b = 0; b < BUCKETS; b++)
+                merged[b] += counts[b].load(std::memory_order_relaxed);
+            return max.load(std::memory_order_relaxed);
+        }
+
+        static LatencyStats summarize(const std::vector<uint64_t>& merged, uint64_t max_ns) {
+            LatencyStats stats;
+            for (auto c : merged)
+                stats.count += c;
+            stats.max_ns = max_ns;
+            stats.p50_ns = percentile(merged, stats.count, 0.50, max_ns);
+            stats.p99_ns = percentile(merged, stats.count, 0.99, max_ns);
+            return stats;
+        }
+
+        static uint64_t percentile(const std::vector<uint64_t>& merged, uint64_t total, double p, uint64_t max_ns) {
+            if (total == 0)
+                return 0;
+            uint64_t rank = uint64_t(p * (total - 1)) + 1;
+            uint64_t seen = 0;
+            for (unsigned b = 0; b < merged.size(); b++) {
+                seen += merged[b];
+                if (seen >= rank)
+                    return std::min(bucketUpper(b), max_ns);
+            }
+            return max_ns;
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKETS> counts{};
+        std::atomic<uint64_t> max{0};
+};
@@ -3,16 +3,31 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <wait.h>
+#include <cstring>
+#include <fstream>
+#include <latch>
 #include "data_samples.hpp"
 
 
+// usage: main [--stats] [--trace trace.json]
+// --stats prints the scheduler counters of every worker once the echo server is done,
+// --trace writes the task runs of every worker as Chrome trace JSON
 int main(int argc, char** argv) {
+    ThreadPoolOptions opts;
+    const char* trace_path = nullptr;
+    for (int a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--stats"))
+            opts.collect_stats = true;
+        else if (!strcmp(argv[a], "--trace") && a + 1 < argc) {
+            trace_path = argv[++a];
+            opts.trace_events = 1 << 20;
+        }
+    }
+
     // making fds
     const int M = 100;
 
     int fd[M][2] = {0};
-    
-    epoll_event events[M];
 
     for (int i = 0; i < M; i++) {
         if (pipe2(fd[i], O_NONBLOCK)) {
@@ -38,52 +53,70 @@ int main(int argc, char** argv) {
     }
 
     if (pid) {
+        // blocking writes: a message is less than PIPE_BUF, so it is never interleaved with another
+        for (int i = 0; i < M; i++) {
+            close(fd[i][0]);
+            fcntl(fd[i][1], F_SETFL, 0);
+        }
         // writing to the random of M desriptors the request with appropriate task
-        for (int p = 0; p < MSGS.size(); p++) {
+        for (size_t p = 0; p < MSGS.size(); p++) {
             std::string msg = MSGS[p].taskToMsg();
             int rand_fd_ind = rand() % M;
-            int count = 0;
-            while(true) {
-                auto written = write(fd[rand_fd_ind][1], msg.c_str() + count, msg.size() - count);
-                count += written;
-                if (errno != EAGAIN || count == msg.size())
-                    break;
+            ssize_t written = write(fd[rand_fd_ind][1], msg.data(), msg.size());
+            if (written != ssize_t(msg.size())) {
+                std::cout << "write error\n";
+                return 1;
             }
         }
+        // the server stops once every pipe is closed
+        for (int i = 0; i < M; i++)
+            close(fd[i][1]);
+        waitpid(pid, nullptr, 0);
     }
     // child process
     else {
-        auto fd_epoll = epoll_create1(0);
-        if (fd_epoll == -1) {
-            std::cout << "Bad epoll creation\n";
-            return 1;
-        }
+        for (int i = 0; i < M; i++)
+            close(fd[i][1]);
+
+        ThreadPool pool{15, opts};
 
-        // setting interest list up 
+        // the pool's workers poll the pipes themselves, a callback runs as a task whenever
+        // its pipe is readable and never concurrently with itself, so `pending` needs no lock
+        std::vector<std::string> pending(M);
+        std::latch closed(M);
         for (int i = 0; i < M; i++) {
-            events[i].events = EPOLLIN;
-            events[i].data.fd = fd[i][0];
-            if (epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd[i][0], &(events[i])) == -1) {
-                std::cout << "epoll_ctl error\n";
-                return 1;
-            }
+            pool.watch(fd[i][0], EPOLLIN, [i, &fd, &pool, &pending, &closed](uint32_t){
+                bool open;
+                try {
+                    open = SubmitTasksFromFile(fd[i][0], pool, pending[i]);
+                }
+                catch (const std::exception& e) {
+                    // the reactor would rearm the pipe and the error would repeat, give up on it
+                    std::cout << "pipe " << i << ": " << e.what() << "\n";
+                    open = false;
+                }
+                if (!open) {
+                    pool.unwatch(fd[i][0]);
+                    close(fd[i][0]);
+                    closed.count_down();
+                }
+            });
         }
+        closed.wait();
+        pool.shutdown();
 
-        ThreadPool pool{15};
-
-        // listen for M descriptors
-        while(true) {
-            auto nfds = epoll_wait(fd_epoll, events, M, 1000);
-            if (nfds == 0 || nfds == -1) {
-                break;
-            }
-            std::cout << nfds << "\n";
-            for (int i = 0; i < nfds; i++) {
-                auto fd = events[i].data.fd;
-                
-                SubmitTasksFromFile(fd, pool);
+        if (opts.collect_stats) {
+            std::cout << "worker,tasks,busy ms,local pops,steals,failed steals,idle spins,parks\n";
+            auto stats = pool.stats();
+            for (size_t w = 0; w < stats.size(); w++) {
+                auto& s = stats[w];
+                std::cout << w << "," << s.tasks << "," << s.busy_ns / 1e6 << "," << s.local_pops << ","
+                          << s.steals << "," << s.failed_steals << "," << s.idle_spins << "," << s.parks << "\n";
             }
         }
-        close(fd_epoll);
+        if (trace_path) {
+            std::ofstream trace(trace_path);
+            pool.writeTrace(trace);
+        }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "thread_pool.hpp"
+
+/// Outstanding pieces of one parallel loop, or the tasks of a `TaskGroup`. Tasks hold it by
+/// `shared_ptr`, so the last `finish` may still touch it after the waiter has returned.
+class SplitJob {
+        std::atomic<size_t> pending;
+        std::atomic<bool> stopped{false};
+        std::mutex m;
+        std::exception_ptr error;
+        EventCount finished;
+
+    public:
+        /// `pending_` counts the pieces that will `finish` without an `add`, such as the caller's own.
+        explicit SplitJob(size_t pending_ = 1) : pending(pending_) {}
+
+        void add() {
+            pending.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void finish() {
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                finished.notifyAll();
+        }
+
+        bool done() const {
+            return pending.load(std::memory_order_acquire) == 0;
+        }
+
+        bool cancelled() const {
+            return stopped.load(std::memory_order_relaxed);
+        }
+
+        /// Stops the pieces that check `cancelled`, without an error for the waiter.
+        void cancel() {
+            stopped.store(true, std::memory_order_relaxed);
+        }
+
+        /// Runs `f`, the first exception is kept for the waiter and stops the other pieces.
+        template <typename F>
+        void guard(F&& f) {
+            try {
+                f();
+            }
+            catch (...) {
+                if (auto pool = ThreadPool::current())
+                    pool->noteTaskError();
+                auto lg = std::lock_guard(m);
+                if (!error)
+                    error = std::current_exception();
+                stopped.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        /// A piece was destroyed unrun by a cancelling shutdown, the loop fails with `TaskCancelled`.
+        void abandon() {
+            {
+                auto lg = std::lock_guard(m);
+                if (!error)
+                    error = std::make_exception_ptr(TaskCancelled());
+                stopped.store(true, std::memory_order_relaxed);
+            }
+            finish();
+        }
+
+        /// Returns once every piece is done: helps on a worker of `pool`, sleeps anywhere else.
+        void join(ThreadPool& pool) {
+            if (pool.helpUntil([this](){ return done(); }))
+                return;
+            while (!done()) {
+                auto key = finished.prepareWait();
+                if (done()) {
+                    finished.cancelWait();
+                    break;
+                }
+                finished.commitWait(key);
+            }
+        }
+
+        /// `join`, then rethrows the first exception.
+        void wait(ThreadPool& pool) {
+            join(pool);
+            if (error)
+                std::rethrow_exception(error);
+        }
+};
+
+/// @brief Lazy binary splitting of [lo, hi) over the pool.
+///
+/// A worker processes its range `grain` indices at a time and, before each chunk, checks its own
+/// deque: if it is empty, the half it split off last has been stolen (or it never split), so
+/// somebody is hungry and it splits the remaining range in two, pushing the upper half. While the
+/// pushed half stays in the deque nobody needs work and the loop runs without any further splits,
+/// so small loops cost almost nothing and large ones spread as far as thieves ask for.
+///
+/// `Leaf` provides `State begin()`, `void step(State&, Index lo, Index hi)` and `void end(State&)`,
+/// called once per task that processes a piece.
+template <typename Index, typename Leaf>
+class LazySplitter {
+        ThreadPool& pool;
+        const Index grain;
+        Leaf& leaf;
+        std::shared_ptr<SplitJob> job = std::make_shared<SplitJob>();
+
+        void spawn(Index lo, Index hi) {
+            job->add();
+            auto cancel = DropGuard([job = job](){ job->abandon(); });
+            pool.submit(Task([this, job = job, lo, hi, cancel = std::move(cancel)]() mutable {
+                cancel.disarm();
+                job->guard([&](){ run(lo, hi); });
+                job->finish();
+            }));
+        }
+
+        void run(Index lo, Index hi) {
+            auto state = leaf.begin();
+            while (hi - lo > grain && !job->cancelled()) {
+                if (pool.localQueueEmpty()) {
+                    Index mid = lo + (hi - lo) / 2;
+                    spawn(mid, hi);
+                    hi = mid;
+                }
+                else {
+                    leaf.step(state, lo, lo + grain);
+                    lo += grain;
+                }
+            }
+            if (lo < hi && !job->cancelled())
+                leaf.step(state, lo, hi);
+            leaf.end(state);
+        }
+
+    public:
+        LazySplitter(ThreadPool& pool_, Index grain_, Leaf& leaf_)
+            : pool(pool_), grain(grain_ > 0 ? grain_ : 1), leaf(leaf_) {}
+
+        /// Processes [lo, hi) and returns once every piece is done. On a worker the first piece
+        /// runs inline, from any other thread the whole range goes to the pool as one task.
+        void operator()(Index lo, Index hi) {
+            if (lo >= hi)
+                return;
+            if (pool.inPool())
+                job->guard([&](){ run(lo, hi); });
+            else
+                spawn(lo, hi);
+            job->finish();
+            job->wait(pool);
+        }
+};
+
+template <typename Index, typename Body>
+struct ForLeaf {
+    const Body& body;
+
+    struct State {};
+
+    State begin() {
+        return {};
+    }
+
+    void step(State&, Index lo, Index hi) {
+        for (Index i = lo; i < hi; i++)
+            body(i);
+    }
+
+    void end(State&) {}
+};
+
+template <typename Index, typename T, typename Map, typename Reduce>
+struct ReduceLeaf {
+    const T& identity;
+    const Map& map;
+    const Reduce& reduce;
+    std::mutex m{};
+    std::vector<T> partials{};
+
+    T begin() {
+        return identity;
+    }
+
+    void step(T& acc, Index lo, Index hi) {
+        for (Index i = lo; i < hi; i++)
+            acc = reduce(std::move(acc), map(i));
+    }
+
+    void end(T& acc) {
+        auto lg = std::lock_guard(m);
+        partials.push_back(std::move(acc));
+    }
+};
+
+/// @brief Calls `body(i)` for every i in [begin, end) on the pool, `grain` indices at least per piece.
+/// Returns when all calls are done; the first exception thrown by `body` is rethrown here.
+template <typename Index, typename Body>
+void parallel_for(ThreadPool& pool, Index begin, Index end, Index grain, const Body& body) {
+    ForLeaf<Index, Body> leaf{body};
+    LazySplitter<Index, ForLeaf<Index, Body>>(pool, grain, leaf)(begin, end);
+}
+
+/// @brief Folds `map(i)` for every i in [begin, end) with `reduce`, starting each piece from `identity`.
+/// `reduce` has to be associative and commutative: pieces are combined in completion order.
+template <typename Index, typename T, typename Map, typename Reduce>
+T parallel_reduce(ThreadPool& pool, Index begin, Index end, Index grain,
+                  const T& identity, const Map& map, const Reduce& reduce) {
+    ReduceLeaf<Index, T, Map, Reduce> leaf{identity, map, reduce};
+    LazySplitter<Index, ReduceLeaf<Index, T, Map, Reduce>>(pool, grain, leaf)(begin, end);
+
+    T result = identity;
+    for (auto& p : leaf.partials)
+        result = reduce(std::move(result), std::move(p));
+    return result;
+}
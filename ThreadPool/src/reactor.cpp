@@ -0,0 +1,117 @@
+#include "reactor.hpp"
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <system_error>
+#include <unistd.h>
+
+Reactor::Reactor() {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1)
+        throw std::system_error(errno, std::system_category(), "epoll_create1");
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd == -1) {
+        auto err = errno;
+        close(epoll_fd);
+        throw std::system_error(err, std::system_category(), "eventfd");
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+}
+
+Reactor::~Reactor() {
+    close(wake_fd);
+    close(epoll_fd);
+}
+
+void Reactor::watch(int fd, uint32_t events, Callback callback) {
+    auto w = std::make_shared<Watch>();
+    w->fd = fd;
+    w->events = events;
+    w->callback = std::move(callback);
+
+    epoll_event ev{};
+    ev.events = events | EPOLLONESHOT;
+    ev.data.fd = fd;
+
+    auto lg = std::lock_guard(m);
+    auto [it, added] = watches.try_emplace(fd, w);
+    if (!added) {
+        it->second->active.store(false, std::memory_order_relaxed);
+        it->second = w;
+    }
+    if (epoll_ctl(epoll_fd, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) == -1) {
+        auto err = errno;
+        watches.erase(fd);
+        n_watches.store(watches.size(), std::memory_order_relaxed);
+        throw std::system_error(err, std::system_category(), "epoll_ctl");
+    }
+    n_watches.store(watches.size(), std::memory_order_relaxed);
+}
+
+void Reactor::unwatch(int fd) {
+    auto lg = std::lock_guard(m);
+    auto it = watches.find(fd);
+    if (it == watches.end())
+        return;
+    it->second->active.store(false, std::memory_order_relaxed);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    watches.erase(it);
+    n_watches.store(watches.size(), std::memory_order_relaxed);
+}
+
+void Reactor::rearm(const Watch& w) {
+    auto lg = std::lock_guard(m);
+    // the fd may have been unwatched or watched anew meanwhile
+    auto it = watches.find(w.fd);
+    if (it == watches.end() || it->second.get() != &w)
+        return;
+    epoll_event ev{};
+    ev.events = w.events | EPOLLONESHOT;
+    ev.data.fd = w.fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, w.fd, &ev);
+}
+
+void Reactor::poll(int timeout_ms, std::vector<Task>& ready) {
+    epoll_event events[64];
+    int n = epoll_wait(epoll_fd, events, 64, timeout_ms);
+    sleeping.store(false, std::memory_order_relaxed);
+    if (n <= 0)
+        return;
+
+    auto lg = std::lock_guard(m);
+    for (int i = 0; i < n; i++) {
+        int fd = events[i].data.fd;
+        if (fd == wake_fd) {
+            uint64_t count;
+            while (read(wake_fd, &count, sizeof(count)) > 0)
+                ;
+            continue;
+        }
+        auto it = watches.find(fd);
+        if (it == watches.end())
+            continue;
+        ready.emplace_back([this, w = it->second, got = events[i].events](){
+            if (!w->active.load(std::memory_order_relaxed))
+                return;
+            // rearmed even if the callback throws, the fd would go silent otherwise
+            struct Rearm {
+                Reactor* reactor;
+                Watch& w;
+
+                ~Rearm() {
+                    if (w.active.load(std::memory_order_relaxed))
+                        reactor->rearm(w);
+                }
+            } rearm_after{this, *w};
+            w->callback(got);
+        });
+    }
+}
+
+void Reactor::signal() {
+    uint64_t one = 1;
+    [[maybe_unused]] auto n = write(wake_fd, &one, sizeof(one));
+}
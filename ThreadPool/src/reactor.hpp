@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "task.hpp"
+
+/// @brief epoll instance the workers of a `ThreadPool` poll when they run out of tasks.
+///
+/// Every fd is registered with `EPOLLONESHOT`: once it fires it stays disarmed until its
+/// callback has run, so callbacks of one fd never overlap and the callback needs no locking.
+/// An eventfd lets submitters interrupt a worker sleeping in `epoll_wait`.
+class Reactor {
+    public:
+        using Callback = std::function<void(uint32_t events)>;
+
+    private:
+        struct Watch {
+            int fd;
+            uint32_t events;
+            Callback callback;
+            std::atomic<bool> active{true};
+        };
+
+        int epoll_fd = -1;
+        int wake_fd = -1;
+
+        std::mutex m;
+        std::unordered_map<int, std::shared_ptr<Watch>> watches;
+        std::atomic<size_t> n_watches{0};
+
+        // taken by the one worker polling at a time
+        std::atomic<bool> polling{false};
+        // set while that worker may block in `epoll_wait`
+        std::atomic<bool> sleeping{false};
+
+        void rearm(const Watch& w);
+
+    public:
+        /// @warning Throws `std::system_error` if the epoll instance or the eventfd cannot be created.
+        Reactor();
+        ~Reactor();
+
+        Reactor(const Reactor&) = delete;
+        Reactor& operator=(const Reactor&) = delete;
+
+        /// @brief Calls `callback(ready events)` as a pool task whenever `fd` is ready for `events`.
+        /// Replaces an earlier registration of the same fd. Throws `std::system_error` if epoll refuses it.
+        void watch(int fd, uint32_t events, Callback callback);
+
+        /// Callbacks of `fd` that are still queued are skipped, one that is already running carries on.
+        void unwatch(int fd);
+
+        bool watching() const {
+            return n_watches.load(std::memory_order_relaxed) != 0;
+        }
+
+        bool tryAcquire() {
+            return !polling.load(std::memory_order_relaxed) && !polling.exchange(true, std::memory_order_acquire);
+        }
+
+        void release() {
+            polling.store(false, std::memory_order_release);
+        }
+
+        /// @brief Waits up to `timeout_ms` (-1: no limit) and appends a task per ready fd to `ready`.
+        /// Only for the holder of `tryAcquire`. With a timeout the caller has to announce itself with
+        /// `prepareSleep` first and re-check for work, just like `EventCount::prepareWait`.
+        void poll(int timeout_ms, std::vector<Task>& ready);
+
+        void prepareSleep() {
+            sleeping.store(true, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        void cancelSleep() {
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+
+        /// For submitters, after a seq_cst fence (`EventCount::notify` has one): cuts a sleeping poll short.
+        void wake() {
+            if (sleeping.load(std::memory_order_relaxed))
+                signal();
+        }
+
+        /// Unconditionally, for shutdown.
+        void signal();
+};
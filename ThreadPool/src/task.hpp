@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// bytes of captures a task keeps inline before falling back to the heap
+#ifndef TASK_INLINE_SIZE
+#define TASK_INLINE_SIZE 64
+#endif
+
+/// @brief Move-only `void()` callable with `InlineSize` bytes of small-buffer storage.
+///
+/// Unlike `std::function` it accepts move-only callables and never copies them, and
+/// it keeps any nothrow-movable callable of up to `InlineSize` bytes without allocating.
+template <size_t InlineSize>
+class BasicUniqueTask {
+        static_assert(InlineSize >= sizeof(void*), "inline storage must fit at least a pointer");
+
+        struct VTable {
+            void (*invoke)(void* obj);
+            // move-constructs the callable at `dst` from the one at `src` and destroys the latter
+            void (*relocate)(void* dst, void* src);
+            void (*destroy)(void* obj);
+        };
+
+        template <typename F>
+        static constexpr bool fits_inline =
+            sizeof(F) <= InlineSize &&
+            alignof(F) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible_v<F>;
+
+        template <typename F>
+        static void invokeInline(void* obj) {
+            (*static_cast<F*>(obj))();
+        }
+
+        template <typename F>
+        static void relocateInline(void* dst, void* src) {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+
+        template <typename F>
+        static void destroyInline(void* obj) {
+            static_cast<F*>(obj)->~F();
+        }
+
+        // the storage holds an `F*`
+        template <typename F>
+        static void invokeHeap(void* obj) {
+            (**static_cast<F**>(obj))();
+        }
+
+        template <typename F>
+        static void relocateHeap(void* dst, void* src) {
+            *static_cast<F**>(dst) = *static_cast<F**>(src);
+        }
+
+        template <typename F>
+        static void destroyHeap(void* obj) {
+            delete *static_cast<F**>(obj);
+        }
+
+        template <typename F>
+        static constexpr VTable inline_vtable{&invokeInline<F>, &relocateInline<F>, &destroyInline<F>};
+
+        template <typename F>
+        static constexpr VTable heap_vtable{&invokeHeap<F>, &relocateHeap<F>, &destroyHeap<F>};
+
+        alignas(std::max_align_t) unsigned char storage[InlineSize];
+        const VTable* vt = nullptr;
+
+    public:
+        BasicUniqueTask() = default;
+        BasicUniqueTask(std::nullptr_t) {}
+
+        template <
+            typename F,
+            typename D = std::decay_t<F>,
+            typename = std::enable_if_t<!std::is_same_v<D, BasicUniqueTask> && std::is_invocable_v<D&>>
+        >
+        BasicUniqueTask(F&& f) {
+            if constexpr (fits_inline<D>) {
+                new (storage) D(std::forward<F>(f));
+                vt = &inline_vtable<D>;
+            }
+            else {
+                *reinterpret_cast<D**>(storage) = new D(std::forward<F>(f));
+                vt = &heap_vtable<D>;
+            }
+        }
+
+        BasicUniqueTask(BasicUniqueTask&& other) noexcept : vt(other.vt) {
+            if (vt) {
+                vt->relocate(storage, other.storage);
+                other.vt = nullptr;
+            }
+        }
+
+        BasicUniqueTask& operator=(BasicUniqueTask&& other) noexcept {
+            if (this != &other) {
+                reset();
+                vt = other.vt;
+                if (vt) {
+                    vt->relocate(storage, other.storage);
+                    other.vt = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        BasicUniqueTask(const BasicUniqueTask&) = delete;
+        BasicUniqueTask& operator=(const BasicUniqueTask&) = delete;
+
+        ~BasicUniqueTask() {
+            reset();
+        }
+
+        void reset() {
+            if (vt) {
+                vt->destroy(storage);
+                vt = nullptr;
+            }
+        }
+
+        explicit operator bool() const {
+            return vt != nullptr;
+        }
+
+        /// @warning undefined for an empty task
+        void operator()() {
+            vt->invoke(storage);
+        }
+
+        /// true if a callable of type `F` is kept without a heap allocation
+        template <typename F>
+        static constexpr bool storedInline() {
+            return fits_inline<std::decay_t<F>>;
+        }
+};
+
+using UniqueTask = BasicUniqueTask<TASK_INLINE_SIZE>;
+using Task = UniqueTask;
+
+/// What waiters of a task get when `ThreadPool::shutdown(ShutdownMode::Cancel)` destroys it unrun.
+class TaskCancelled : public std::runtime_error {
+    public:
+        TaskCancelled() : std::runtime_error("task cancelled by ThreadPool shutdown") {}
+};
+
+/// @brief Calls `on_drop` on destruction unless `disarm()` was called first.
+///
+/// Tasks that somebody waits for carry one and disarm it when they start, so a task the pool
+/// destroys without running still completes whatever the waiter sleeps on.
+template <typename F>
+class DropGuard {
+        F on_drop;
+        bool armed = true;
+
+    public:
+        explicit DropGuard(F f) : on_drop(std::move(f)) {}
+
+        DropGuard(DropGuard&& other) noexcept : on_drop(std::move(other.on_drop)), armed(other.armed) {
+            other.armed = false;
+        }
+
+        DropGuard(const DropGuard&) = delete;
+        DropGuard& operator=(const DropGuard&) = delete;
+        DropGuard& operator=(DropGuard&&) = delete;
+
+        ~DropGuard() {
+            if (armed)
+                on_drop();
+        }
+
+        void disarm() {
+            armed = false;
+        }
+};
+
+/// Scheduling lane of a task, `High` tasks are popped and stolen before any `Normal` one.
+enum class Priority : uint8_t {
+    High,
+    Normal
+};
+
+constexpr unsigned PRIORITIES = 2;
+
+/// @brief Heap cell a queued task lives in, the pool's queues pass pointers to these around.
+///
+/// Cells are recycled through per-thread magazines of `TaskCell::BATCH` cells: a thread
+/// allocates from and frees into its own magazines without locking and only exchanges a
+/// whole magazine with a process-wide depot (under a mutex) when both of its are empty or full.
+/// Once the caches are warm, submitting and running a task does not call malloc.
+struct TaskCell {
+    static constexpr size_t BATCH = 64;
+
+    Task task;
+    TaskCell* next = nullptr;
+    Priority priority = Priority::Normal;
+    // steady clock nanoseconds, `enqueued_ns` is only stamped when the pool tracks latency
+    int64_t enqueued_ns = 0;
+    int64_t deadline_ns = INT64_MAX;
+
+    static TaskCell* make(Task&& task);
+    /// Destroys the task and returns the cell to the calling thread's magazine.
+    static void recycle(TaskCell* cell);
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include "thread_pool.hpp"
+#include "parallel.hpp"
+
+/// @brief Fork-join scope over a `ThreadPool`: tasks spawned into a group, also from inside its
+/// own tasks, can be waited for and cancelled together.
+///
+/// `wait` on a worker runs queued tasks until the group is done, so recursive groups never
+/// block a worker or need extra threads; on any other thread it sleeps. `cancel` makes the
+/// tasks that have not started yet return right away, running ones finish normally.
+/// The first exception thrown by a task cancels the group and is rethrown by `wait`.
+/// The destructor waits as well, so no task outlives its group.
+class TaskGroup {
+        ThreadPool& pool;
+        // shared with the queued tasks; unlike a parallel loop the group has no piece of its own
+        std::shared_ptr<SplitJob> job = std::make_shared<SplitJob>(0);
+
+    public:
+        explicit TaskGroup(ThreadPool& pool_) : pool(pool_) {}
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        ~TaskGroup() {
+            job->join(pool);
+        }
+
+        /// Queues `f()` as a task of the group; does nothing once the group is cancelled.
+        template <typename F>
+        void spawn(F&& f, Priority prio = Priority::Normal) {
+            if (cancelled())
+                return;
+            job->add();
+            // a cancelling pool shutdown destroys the task unrun, the group still has to hear of it
+            auto dropped = DropGuard([job = job](){ job->abandon(); });
+            pool.submit(Task([job = job, f = std::forward<F>(f), dropped = std::move(dropped)]() mutable {
+                dropped.disarm();
+                if (!job->cancelled())
+                    job->guard(f);
+                job->finish();
+            }), prio);
+        }
+
+        /// Returns once every task spawned so far, and everything they spawned, is done or skipped.
+        /// Rethrows the first exception; the group can be reused after `reset`.
+        void wait() {
+            job->wait(pool);
+        }
+
+        void cancel() {
+            job->cancel();
+        }
+
+        bool cancelled() const {
+            return job->cancelled();
+        }
+
+        /// After a `wait`: clears the cancellation and the exception for another round of tasks.
+        void reset() {
+            job = std::make_shared<SplitJob>(0);
+        }
+};
@@ -1,5 +1,226 @@
 #include "thread_pool.hpp"
+#include <iomanip>
 
-ThreadPool* ThreadPool::self;
 thread_local unsigned ThreadPool::ind;
-std::atomic_bool ThreadPool::done;
\ No newline at end of file
+thread_local ThreadPool* ThreadPool::local_pool;
+
+void ThreadPool::writeTrace(std::ostream& out) const {
+    auto flags = out.flags();
+    auto precision = out.precision();
+    // microseconds with nanosecond digits
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    const char* sep = "\n";
+    for (unsigned i = 0; i < n_threads; i++) {
+        out << sep << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+            << ",\"args\":{\"name\":\"worker " << i << "\"}}";
+        sep = ",\n";
+        for (auto& e : queue[i].trace) {
+            out << sep << "{\"name\":\"" << (e.priority == Priority::High ? "high" : "normal")
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << i
+                << ",\"ts\":" << (e.begin_ns - start_ns) / 1000.0
+                << ",\"dur\":" << (e.end_ns - e.begin_ns) / 1000.0 << "}";
+        }
+    }
+    out << "\n]}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+namespace {
+
+// full magazines of `TaskCell::BATCH` cells chained through `next`, shared by all threads
+struct CellDepot {
+    std::mutex m;
+    std::vector<TaskCell*> full;
+
+    ~CellDepot() {
+        for (auto head : full) {
+            while (head) {
+                auto next = head->next;
+                delete head;
+                head = next;
+            }
+        }
+    }
+};
+
+CellDepot& cellDepot() {
+    static CellDepot depot;
+    return depot;
+}
+
+// `loaded` holds up to BATCH cells, `spare` is either empty or full
+struct CellMagazines {
+    TaskCell* loaded = nullptr;
+    size_t loaded_count = 0;
+    TaskCell* spare = nullptr;
+
+    ~CellMagazines() {
+        if (spare) {
+            auto& depot = cellDepot();
+            auto lg = std::lock_guard(depot.m);
+            depot.full.push_back(spare);
+        }
+        while (loaded) {
+            auto next = loaded->next;
+            delete loaded;
+            loaded = next;
+        }
+    }
+};
+
+thread_local CellMagazines magazines;
+
+}
+
+TaskCell* TaskCell::make(Task&& task) {
+    auto& mag = magazines;
+    if (!mag.loaded) {
+        if (mag.spare) {
+            mag.loaded = mag.spare;
+            mag.spare = nullptr;
+        }
+        else {
+            auto& depot = cellDepot();
+            {
+                auto lg = std::lock_guard(depot.m);
+                if (!depot.full.empty()) {
+                    mag.loaded = depot.full.back();
+                    depot.full.pop_back();
+                }
+            }
+            if (!mag.loaded) {
+                for (size_t i = 0; i < BATCH; i++) {
+                    auto cell = new TaskCell;
+                    cell->next = mag.loaded;
+                    mag.loaded = cell;
+                }
+            }
+        }
+        mag.loaded_count = BATCH;
+    }
+
+    auto cell = mag.loaded;
+    mag.loaded = cell->next;
+    mag.loaded_count--;
+    cell->next = nullptr;
+    cell->priority = Priority::Normal;
+    cell->enqueued_ns = 0;
+    cell->deadline_ns = INT64_MAX;
+    cell->task = std::move(task);
+    return cell;
+}
+
+void TaskCell::recycle(TaskCell* cell) {
+    cell->task.reset();
+
+    auto& mag = magazines;
+    if (mag.loaded_count == BATCH) {
+        if (mag.spare) {
+            auto& depot = cellDepot();
+            auto lg = std::lock_guard(depot.m);
+            depot.full.push_back(mag.spare);
+        }
+        mag.spare = mag.loaded;
+        mag.loaded = nullptr;
+        mag.loaded_count = 0;
+    }
+    cell->next = mag.loaded;
+    mag.loaded = cell;
+    mag.loaded_count++;
+}
+
+
+void FutureStateBase::markReady() {
+    std::vector<Task> ready_continuations;
+    {
+        auto lg = std::lock_guard(m);
+        is_ready.store(true, std::memory_order_release);
+        ready_continuations.swap(continuations);
+    }
+    cv.notify_all();
+
+    for (auto& t : ready_continuations) {
+        if (pool)
+            pool->submit(std::move(t));
+        else
+            t();
+    }
+}
+
+void FutureStateBase::noteError() {
+    if (pool)
+        pool->noteTaskError();
+}
+
+void FutureStateBase::wait() {
+    if (ready())
+        return;
+
+    if (pool && pool->helpUntil([this](){ return ready(); }))
+        return;
+
+    auto lk = std::unique_lock(m);
+    cv.wait(lk, [this](){ return is_ready.load(std::memory_order_relaxed); });
+}
+
+void FutureStateBase::onReady(Task t) {
+    {
+        auto lg = std::lock_guard(m);
+        if (!is_ready.load(std::memory_order_relaxed)) {
+            continuations.push_back(std::move(t));
+            return;
+        }
+    }
+    if (pool)
+        pool->submit(std::move(t));
+    else
+        t();
+}
+
+Future<void> when_all(std::vector<Future<void>> futures) {
+    struct Join {
+        std::atomic<size_t> left;
+        std::mutex m;
+        std::exception_ptr error;
+        std::shared_ptr<FutureState<void>> out;
+
+        Join(size_t n, std::shared_ptr<FutureState<void>> out_) : left(n), out(std::move(out_)) {}
+
+        void arrive(std::exception_ptr e) {
+            if (e) {
+                auto lg = std::lock_guard(m);
+                if (!error)
+                    error = std::move(e);
+            }
+            if (left.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+            if (error)
+                out->setException(error);
+            else
+                out->run([](){});
+        }
+    };
+
+    ThreadPool* pool = futures.empty() ? nullptr : futures[0].state->owner();
+    auto out = std::make_shared<FutureState<void>>(pool);
+    if (futures.empty()) {
+        out->run([](){});
+        return Future<void>(std::move(out));
+    }
+
+    auto join = std::make_shared<Join>(futures.size(), out);
+    for (auto& f : futures) {
+        auto in = std::move(f.state);
+        auto raw_in = in.get();
+        auto cancel = DropGuard([join](){ join->arrive(std::make_exception_ptr(TaskCancelled())); });
+        raw_in->onReady([in = std::move(in), join, cancel = std::move(cancel)]() mutable {
+            cancel.disarm();
+            join->arrive(in->exception());
+        });
+    }
+    return Future<void>(std::move(out));
+}
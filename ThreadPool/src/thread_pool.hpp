@@ -8,110 +8,539 @@
 #include <atomic>
 #include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <algorithm>
+#include <tuple>
+#include <array>
+#include <pthread.h>
+#include <chrono>
+#include <coroutine>
+#include <stdexcept>
+#include "chase_lev_deque.hpp"
+#include "event_count.hpp"
+#include "future.hpp"
+#include "latency_histogram.hpp"
+#include "reactor.hpp"
+#include "task.hpp"
+#include "topology.hpp"
+#include "worker_stats.hpp"
 
-using Task = std::function<void()>;
+/// How an idle worker waits for new tasks: it first retries `spin_rounds` times with
+/// exponentially growing `pause` backoff, then `yield_rounds` times with `std::this_thread::yield()`
+/// and after that parks on a futex until a `submit` wakes it up.
+///
+/// With `topology_aware` the workers are pinned to CPUs in `CpuTopology` order and a thief
+/// tries its SMT sibling first, then workers sharing its L3, its NUMA node and only then the rest.
+///
+/// With `track_latency` every task is stamped at submit and the time it waited in the queues
+/// goes to a per-worker, per-priority histogram read by `ThreadPool::queueLatency`.
+///
+/// With `collect_stats` the workers count pops, steals, idle rounds, parks and task run time
+/// for `ThreadPool::stats`. A non-zero `trace_events` records the begin and end of up to that
+/// many task runs per worker for `ThreadPool::writeTrace`.
+///
+/// A task that throws never takes its worker down. Submitted through a future, a `TaskGroup` or a
+/// parallel loop, the exception goes to whoever waits for it; a plain `Task` has nobody waiting,
+/// so its exception goes to `on_error` (on the worker, which must not throw) or is dropped.
+/// Either way it counts in `WorkerStats::errors`.
+struct ThreadPoolOptions {
+    unsigned spin_rounds = 64;
+    unsigned yield_rounds = 8;
+    bool topology_aware = false;
+    bool track_latency = false;
+    bool collect_stats = false;
+    size_t trace_events = 0;
+    std::function<void(std::exception_ptr)> on_error;
+};
+
+/// What `ThreadPool::shutdown` does with tasks that have not started yet: `Drain` runs them and
+/// everything they submit in turn, `Cancel` destroys them unrun, failing their futures with `TaskCancelled`.
+enum class ShutdownMode {
+    Drain,
+    Cancel
+};
+
+/// Where `ThreadPool::submitBulk` puts a batch: `OneQueue` hands all of it to one queue in a
+/// single operation and idle workers steal from there, `AllQueues` cuts it into one slice per
+/// worker queue so that every worker has something to start with right away.
+enum class BulkSpread {
+    OneQueue,
+    AllQueues
+};
 
 class ThreadPool {
-        const unsigned BAD_INDEX = UINT32_MAX;
+        // the deques are owned by the worker with the same index: it pushes and pops there without locks,
+        // other workers steal from the top end; there is one per `Priority`. Tasks submitted from threads
+        // outside of the pool go to the inbox and are moved into the deques in one batch by whichever
+        // worker gets there first. High priority tasks with a deadline wait in a min-heap instead.
+        struct alignas(64) WorkerQueue {
+            std::array<ChaseLevDeque<TaskCell*>, PRIORITIES> deques;
+            std::mutex inbox_m;
+            std::vector<TaskCell*> inbox;
+            std::atomic<size_t> inbox_size{0};
+
+            // other workers, nearest first; `level_end[l]` ends the ones at StealLevel `l`
+            std::vector<unsigned> victims;
+            std::array<unsigned, STEAL_LEVELS> level_end{};
+            std::array<std::atomic<uint64_t>, STEAL_LEVELS> steals{};
+            int cpu = -1;
+
+            std::mutex deadline_m;
+            std::vector<TaskCell*> deadlines;
+            std::atomic<int64_t> earliest_deadline{INT64_MAX};
+
+            std::array<LatencyHistogram, PRIORITIES> latency;
+            WorkerCounters counters;
+            // written by the owner only, read once the pool is idle
+            std::vector<TraceEvent> trace;
+
+            // task counts behind `isIdle`: `pushed` and `completed` are written by the owner only,
+            // `posted` counts what went through the inbox or the deadline heap under their mutexes
+            alignas(64) std::atomic<uint64_t> pushed{0};
+            std::atomic<uint64_t> completed{0};
+            std::atomic<uint64_t> posted{0};
 
-        struct alignas(64) QueuePair {
-            std::mutex m;
-            std::deque<Task> q;
+            bool dequesEmpty() const {
+                for (auto& deque : deques) {
+                    if (!deque.empty())
+                        return false;
+                }
+                return true;
+            }
         };
 
-        static std::atomic<bool> done;
+        // workers leave once they run out of tasks
+        std::atomic<bool> done{false};
+        // workers leave without touching the queued tasks
+        std::atomic<bool> cancelled{false};
+        // `submit` drops tasks instead of queueing them
+        std::atomic<bool> stopped{false};
+        // tasks destroyed unrun by `shutdown`
+        std::atomic<uint64_t> dropped{0};
         const unsigned n_threads;
+        const ThreadPoolOptions opts;
         std::vector<std::thread> threads;
 
-        std::vector<QueuePair> queue;
+        std::vector<WorkerQueue> queue;
 
-        static thread_local unsigned ind;
-        static ThreadPool* self;
+        // parked workers sleep here, while one of them may sleep in the reactor instead
+        EventCount idle;
+        Reactor reactor;
+        // a busy worker still polls the reactor every this many tasks
+        static constexpr unsigned IO_POLL_INTERVAL = 64;
+        // `waitIdle` callers sleep here
+        EventCount drained;
+        // trace timestamps are relative to this
+        const int64_t start_ns = nowNs();
 
+        static thread_local unsigned ind;
+        // pool the calling thread works for, `ind` is meaningful only for this pool
+        static thread_local ThreadPool* local_pool;
 
         void worker() {
-            while (true) {
-                Task t;
-                if (tryPopLocal(t) || trySteal(t)) {
-                    try {
-                        t();
+            unsigned idle_rounds = 0;
+            unsigned since_poll = 0;
+            while (!cancelled.load(std::memory_order_relaxed)) {
+                TaskCell* t;
+                if (findTask(t)) {
+                    idle_rounds = 0;
+                    runTask(t);
+                    if (++since_poll == IO_POLL_INTERVAL) {
+                        since_poll = 0;
+                        pollIo(false);
                     }
-                    catch(std::exception& e) {
-                        std::cout << e.what();
-                        done = true;
-                        throw e;
-                    }
-                } 
-                else if (done)
+                    continue;
+                }
+                if (done.load(std::memory_order_relaxed))
                     break;
-                else {
+                // the worker that finishes the last task finds nothing right after and wakes `waitIdle`
+                if (idle_rounds == 0 && drained.hasWaiters() && isIdle())
+                    drained.notifyAll();
+                if (idle_rounds == 0 && pollIo(false))
+                    continue;
+
+                if (idle_rounds < opts.spin_rounds) {
+                    for (unsigned i = 0; i < (1u << std::min(idle_rounds, 6u)); i++)
+                        asm volatile ("pause");
+                    idle_rounds++;
+                    count(&WorkerCounters::idle_spins);
+                }
+                else if (idle_rounds - opts.spin_rounds < opts.yield_rounds) {
                     std::this_thread::yield();
+                    idle_rounds++;
+                    count(&WorkerCounters::idle_spins);
+                }
+                else {
+                    if (!pollIo(true))
+                        park();
+                    idle_rounds = 0;
                 }
             }
         }
 
-        // return true if stealing was successful and this thread get a task, otherwise return false
-        bool trySteal(Task& t) {
-            if (n_threads < 2)
+        bool findTask(TaskCell*& t) {
+            if (tryPopLocal(t)) {
+                count(&WorkerCounters::local_pops);
+                return true;
+            }
+            if (trySteal(t))
+                return true;
+            count(&WorkerCounters::failed_steals);
+            return false;
+        }
+
+        void count(std::atomic<uint64_t> WorkerCounters::* counter, uint64_t by = 1) {
+            if (opts.collect_stats)
+                WorkerCounters::bump(queue[ind].counters.*counter, by);
+        }
+
+        void runTask(TaskCell* t) {
+            auto& wq = queue[ind];
+            bool timed = opts.collect_stats || opts.trace_events != 0;
+            auto prio = t->priority;
+            int64_t begin = t->enqueued_ns || timed ? nowNs() : 0;
+            if (t->enqueued_ns)
+                wq.latency[unsigned(prio)].record(begin - t->enqueued_ns);
+            try {
+                t->task();
+            }
+            catch (...) {
+                noteTaskError();
+                if (opts.on_error) {
+                    try {
+                        opts.on_error(std::current_exception());
+                    }
+                    catch (...) {}
+                }
+            }
+            TaskCell::recycle(t);
+            if (timed) {
+                auto end = nowNs();
+                count(&WorkerCounters::tasks);
+                count(&WorkerCounters::busy_ns, end - begin);
+                if (wq.trace.size() < opts.trace_events)
+                    wq.trace.push_back({begin, end, prio});
+            }
+            auto& completed = wq.completed;
+            completed.store(completed.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Every task is counted as submitted before it can be counted as completed, so summing up
+        // all completions first and all submissions after never finds more completions. Equal sums
+        // mean nothing was queued or running in between, including tasks that tasks submitted.
+        bool isIdle() const {
+            uint64_t finished = dropped.load(std::memory_order_acquire);
+            for (auto& wq : queue)
+                finished += wq.completed.load(std::memory_order_acquire);
+            uint64_t started = 0;
+            for (auto& wq : queue)
+                started += wq.pushed.load(std::memory_order_relaxed) + wq.posted.load(std::memory_order_relaxed);
+            return finished == started;
+        }
+
+        // Queues `t` and counts it, false once the pool is stopped. The check is made under the
+        // locks `dropQueued` takes, so a task is either dropped here or found there.
+        bool enqueue(TaskCell* t) {
+            if (t->deadline_ns != INT64_MAX) {
+                auto& wq = local_pool == this ? queue[ind] : queue[nextRandom() % n_threads];
+                auto lg = std::lock_guard(wq.deadline_m);
+                if (stopped.load(std::memory_order_relaxed))
+                    return false;
+                wq.posted.fetch_add(1, std::memory_order_relaxed);
+                wq.deadlines.push_back(t);
+                std::push_heap(wq.deadlines.begin(), wq.deadlines.end(), laterDeadline);
+                wq.earliest_deadline.store(wq.deadlines.front()->deadline_ns, std::memory_order_relaxed);
+            }
+            else if (local_pool == this) {
+                // workers are joined before `dropQueued` empties their deques
+                auto& wq = queue[ind];
+                wq.pushed.store(wq.pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                wq.deques[unsigned(t->priority)].push(t);
+            }
+            else {
+                return post(queue[nextRandom() % n_threads], &t, 1);
+            }
+            return true;
+        }
+
+        // appends `n` cells to the inbox of `wq` under one lock, false once the pool is stopped
+        bool post(WorkerQueue& wq, TaskCell* const* cells, size_t n) {
+            auto lg = std::lock_guard(wq.inbox_m);
+            if (stopped.load(std::memory_order_relaxed))
                 return false;
+            wq.posted.fetch_add(n, std::memory_order_relaxed);
+            wq.inbox.insert(wq.inbox.end(), cells, cells + n);
+            wq.inbox_size.store(wq.inbox.size(), std::memory_order_relaxed);
+            return true;
+        }
 
-            auto th1 = rand() % n_threads;
-            auto th2 = rand() % n_threads;
-            
-            while (th1 == th2)
-                th2 = rand() % n_threads;
-            
-            if (th1 > th2)
-                std::swap(th1, th2);
-
-            auto& m1 = queue[th1].m;
-            auto& m2 = queue[th2].m;
-
-            auto& q1 = queue[th1].q;
-            auto& q2 = queue[th2].q;
-
-            auto lg1 = std::lock_guard(m1);
-            auto lg2 = std::lock_guard(m2);
-
-            if (q1.size() > q2.size()) {
-                auto stealed = q1.back();
-                q1.pop_back();
-                if (ind == th2) {
-                    t = stealed;
-                    return true;
+        // copied out first, destroying a task may submit again
+        static void dropCells(TaskCell* const* cells, size_t n) {
+            std::vector<TaskCell*> left(cells, cells + n);
+            for (auto t : left)
+                TaskCell::recycle(t);
+        }
+
+        // joins the workers, then destroys whatever is still queued
+        void stop() {
+            stopped.store(true);
+            done.store(true);
+            idle.notifyAll();
+            reactor.signal();
+            for (auto& th : threads) {
+                if (th.joinable())
+                    th.join();
+            }
+            threads.clear();
+            dropQueued();
+        }
+
+        void dropQueued() {
+            std::vector<TaskCell*> left;
+            for (auto& wq : queue) {
+                TaskCell* t;
+                for (auto& dq : wq.deques) {
+                    while (dq.pop(t))
+                        left.push_back(t);
                 }
-                q2.push_front(stealed);
+                {
+                    auto lg = std::lock_guard(wq.inbox_m);
+                    left.insert(left.end(), wq.inbox.begin(), wq.inbox.end());
+                    wq.inbox.clear();
+                    wq.inbox_size.store(0, std::memory_order_relaxed);
+                }
+                {
+                    auto lg = std::lock_guard(wq.deadline_m);
+                    left.insert(left.end(), wq.deadlines.begin(), wq.deadlines.end());
+                    wq.deadlines.clear();
+                    wq.earliest_deadline.store(INT64_MAX, std::memory_order_relaxed);
+                }
+            }
+            // outside of the locks: a destroyed task may fail a future whose continuations get submitted
+            for (auto t : left)
+                TaskCell::recycle(t);
+            dropped.fetch_add(left.size(), std::memory_order_release);
+            drained.notifyAll();
+        }
+
+        // runs one queued task on the calling worker, so that a worker waiting for
+        // a result keeps the pool busy instead of blocking; false if nothing was found
+        bool runOne() {
+            TaskCell* t;
+            if (findTask(t)) {
+                runTask(t);
+                return true;
+            }
+            return false;
+        }
+
+        // Polls the reactor if no other worker does and pushes a task per ready fd into the own
+        // deque. Blocking, it sleeps in epoll_wait instead of parking; true if it did not find
+        // the reactor busy, i.e. it polled or found work before going to sleep.
+        bool pollIo(bool block) {
+            if (!reactor.watching() || !reactor.tryAcquire())
                 return false;
-            } 
-            
-            if (q1.size() < q2.size()) {
-                auto stealed = q2.back();
-                q2.pop_back();
-                if (th1 == ind) {
-                    t = stealed;
+            static thread_local std::vector<Task> ready;
+            static thread_local std::vector<TaskCell*> cells;
+
+            int timeout_ms = 0;
+            if (block) {
+                reactor.prepareSleep();
+                if (done.load(std::memory_order_relaxed) || hasWork()) {
+                    reactor.cancelSleep();
+                    reactor.release();
                     return true;
                 }
-                q1.push_front(stealed);
-                return false;
+                timeout_ms = -1;
+            }
+            reactor.poll(timeout_ms, ready);
+            reactor.release();
+            if (ready.empty())
+                return block;
+
+            int64_t enqueued_ns = opts.track_latency ? nowNs() : 0;
+            for (auto& r : ready) {
+                auto t = TaskCell::make(std::move(r));
+                t->enqueued_ns = enqueued_ns;
+                cells.push_back(t);
+            }
+            auto& wq = queue[ind];
+            wq.pushed.store(wq.pushed.load(std::memory_order_relaxed) + cells.size(), std::memory_order_relaxed);
+            wq.deques[unsigned(Priority::Normal)].pushBulk(cells.data(), cells.size());
+            if (cells.size() > 1)
+                wakeWorker();
+            ready.clear();
+            cells.clear();
+            return true;
+        }
+
+        // a parked worker, or the one sleeping in the reactor if none is parked
+        void wakeWorker() {
+            if (!idle.notify())
+                reactor.wake();
+        }
+
+        // sleeps until the next `submit` unless some work showed up after the last failed attempt
+        void park() {
+            auto key = idle.prepareWait();
+            if (done.load(std::memory_order_relaxed) || hasWork()) {
+                idle.cancelWait();
+                return;
+            }
+            count(&WorkerCounters::parks);
+            idle.commitWait(key);
+        }
+
+        bool hasWork() const {
+            for (auto& wq : queue) {
+                if (!wq.dequesEmpty() || wq.inbox_size.load(std::memory_order_relaxed) != 0 ||
+                    wq.earliest_deadline.load(std::memory_order_relaxed) != INT64_MAX)
+                    return true;
             }
             return false;
         }
 
-        bool tryPopLocal(Task& t) {
-            auto& m = queue[ind].m;
-            auto& q = queue[ind].q;
+        // return true if stealing was successful and this thread get a task, otherwise return false
+        // high priority work anywhere is preferred over normal work next door
+        bool trySteal(TaskCell*& t) {
+            auto& self_q = queue[ind];
+            for (unsigned lane = 0; lane < PRIORITIES; lane++) {
+                unsigned begin = 0;
+                for (unsigned level = 0; level < STEAL_LEVELS; level++) {
+                    auto end = self_q.level_end[level];
+                    if (begin == end)
+                        continue;
+
+                    // random start, so that thieves at the same level spread over their victims
+                    auto start = nextRandom() % (end - begin);
+                    for (unsigned k = 0; k < end - begin; k++) {
+                        auto& victim = queue[self_q.victims[begin + (start + k) % (end - begin)]];
+                        if (stealFrom(victim, Priority(lane), t)) {
+                            self_q.steals[level].fetch_add(1, std::memory_order_relaxed);
+                            return true;
+                        }
+                    }
+                    begin = end;
+                }
+            }
+            return false;
+        }
 
-            auto lg = std::lock_guard(m);
+        bool stealFrom(WorkerQueue& victim, Priority lane, TaskCell*& t) {
+            if (lane == Priority::High)
+                return victim.deques[unsigned(Priority::High)].steal(t) || popDeadline(victim, t);
+            return victim.deques[unsigned(Priority::Normal)].steal(t) || takeInbox(victim, t);
+        }
 
-            if (q.empty())
+        // earliest deadline first; gives up rather than waits if somebody else holds the heap
+        bool popDeadline(WorkerQueue& wq, TaskCell*& t) {
+            if (wq.earliest_deadline.load(std::memory_order_relaxed) == INT64_MAX)
+                return false;
+            auto lk = std::unique_lock(wq.deadline_m, std::try_to_lock);
+            if (!lk.owns_lock() || wq.deadlines.empty())
                 return false;
-            
-            t = q.back();
-            q.pop_back();
 
+            std::pop_heap(wq.deadlines.begin(), wq.deadlines.end(), laterDeadline);
+            t = wq.deadlines.back();
+            wq.deadlines.pop_back();
+            wq.earliest_deadline.store(
+                wq.deadlines.empty() ? INT64_MAX : wq.deadlines.front()->deadline_ns, std::memory_order_relaxed);
             return true;
         }
 
+        static bool laterDeadline(const TaskCell* a, const TaskCell* b) {
+            return a->deadline_ns > b->deadline_ns;
+        }
+
+        // without topology every other worker is a remote victim
+        void buildStealOrder() {
+            CpuTopology topo;
+            if (opts.topology_aware)
+                topo = CpuTopology::detect();
+
+            for (unsigned i = 0; i < n_threads; i++) {
+                auto& wq = queue[i];
+                for (unsigned j = 0; j < n_threads; j++) {
+                    if (j != i)
+                        wq.victims.push_back(j);
+                }
+                if (!opts.topology_aware) {
+                    wq.level_end.fill(0);
+                    wq.level_end[unsigned(StealLevel::Remote)] = wq.victims.size();
+                    continue;
+                }
+
+                auto cpuOf = [&](unsigned w){ return topo.cpus[w % topo.cpus.size()]; };
+                auto levelOf = [&](unsigned w){ return unsigned(CpuTopology::level(cpuOf(i), cpuOf(w))); };
+                std::stable_sort(wq.victims.begin(), wq.victims.end(), [&](unsigned a, unsigned b){
+                    return levelOf(a) < levelOf(b);
+                });
+                for (unsigned level = 0; level < STEAL_LEVELS; level++) {
+                    wq.level_end[level] = std::upper_bound(wq.victims.begin(), wq.victims.end(), level,
+                        [&](unsigned l, unsigned w){ return l < levelOf(w); }) - wq.victims.begin();
+                }
+                wq.cpu = cpuOf(i).cpu;
+            }
+        }
+
+        static void pinTo(int cpu) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+
+        // overdue deadlines first, then high, then normal priority
+        bool tryPopLocal(TaskCell*& t) {
+            auto& wq = queue[ind];
+            auto earliest = wq.earliest_deadline.load(std::memory_order_relaxed);
+            if (earliest != INT64_MAX && earliest <= nowNs() && popDeadline(wq, t))
+                return true;
+            return wq.deques[unsigned(Priority::High)].pop(t) || popDeadline(wq, t) ||
+                   wq.deques[unsigned(Priority::Normal)].pop(t) || takeInbox(wq, t);
+        }
+
+        // moves the whole inbox of `from` into the deques of the calling worker
+        // and pops the oldest of the highest priority into `t`
+        bool takeInbox(WorkerQueue& from, TaskCell*& t) {
+            if (from.inbox_size.load(std::memory_order_relaxed) == 0)
+                return false;
+
+            // swapped with the inbox, so both vectors keep their capacity between batches
+            static thread_local std::vector<TaskCell*> batch;
+            {
+                auto lg = std::lock_guard(from.inbox_m);
+                batch.swap(from.inbox);
+                from.inbox_size.store(0, std::memory_order_relaxed);
+            }
+            if (batch.empty())
+                return false;
+
+            auto& own = queue[ind];
+            for (size_t i = batch.size(); i-- > 0;)
+                own.deques[unsigned(batch[i]->priority)].push(batch[i]);
+            // there is more than this worker can run right now, let a parked one steal it
+            if (batch.size() > 1)
+                wakeWorker();
+            batch.clear();
+            return own.deques[unsigned(Priority::High)].pop(t) || own.deques[unsigned(Priority::Normal)].pop(t);
+        }
+
+        static int64_t nowNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // xorshift, `rand()` takes a global lock in glibc
+        static uint32_t nextRandom() {
+            static thread_local uint32_t state =
+                static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1;
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+
     public:
 
         /// Not DefaultConstructable
@@ -127,48 +556,289 @@ class ThreadPool {
 
         /// @brief  Constructs a ThreadPool with work stealing implementation of `n_threads_` threads 
         /// @warning The behavior of constructor and any other class methods is undefined if `n_threads_` is 0
-        explicit ThreadPool(const unsigned n_threads_)
-            : n_threads(n_threads_), queue(std::vector<QueuePair>{n_threads})
+        explicit ThreadPool(const unsigned n_threads_, const ThreadPoolOptions& opts_ = {})
+            : n_threads(n_threads_), opts(opts_), queue(n_threads)
         {
-            done = false, 
-            self = this;
-            ind = BAD_INDEX;
+            for (auto& wq : queue)
+                wq.trace.reserve(opts.trace_events);
+            buildStealOrder();
             try {
                 for (unsigned i = 0; i < n_threads; i++) {
                     threads.push_back(std::thread([this, i](){
                         ind = i;
+                        local_pool = this;
+                        if (queue[i].cpu != -1)
+                            pinTo(queue[i].cpu);
                         this->worker();
                     }));
                 }
             }
             catch(...) {
-                done = true;
+                // nothing was submitted yet, the started workers just leave
+                stop();
                 throw;
             }
         }
+
+        /// Runs everything still queued before the workers are joined, see `shutdown`.
         ~ThreadPool() {
-            done = true;
-            for (auto& th : threads) {
-                if (th.joinable())
-                    th.join();
+            shutdown(ShutdownMode::Drain);
+        }
+
+        /// @brief Blocks until every queue is empty and no task is running, tasks spawned by
+        /// other tasks included. Sleeps on a futex, the last worker to go idle wakes it up.
+        /// @warning Throws `std::logic_error` on a worker of this pool, which would wait for itself.
+        void waitIdle() {
+            if (local_pool == this)
+                throw std::logic_error("ThreadPool::waitIdle called from one of its workers");
+            while (!isIdle()) {
+                auto key = drained.prepareWait();
+                if (isIdle()) {
+                    drained.cancelWait();
+                    break;
+                }
+                drained.commitWait(key);
             }
-            self = nullptr;
         }
 
+        /// @brief Stops the pool and joins the workers, later calls do nothing.
+        /// With `Drain` every queued task runs first, with `Cancel` only the running ones finish.
+        /// After that `submit` destroys tasks right away, so their futures fail with `TaskCancelled`;
+        /// tasks submitted from outside while a drain finishes may meet the same fate.
+        /// @warning Throws `std::logic_error` on a worker of this pool.
+        void shutdown(ShutdownMode mode = ShutdownMode::Drain) {
+            if (local_pool == this)
+                throw std::logic_error("ThreadPool::shutdown called from one of its workers");
+            if (threads.empty())
+                return;
+            if (mode == ShutdownMode::Drain)
+                waitIdle();
+            else
+                cancelled.store(true);
+            stop();
+        }
+
+        using Deadline = std::chrono::steady_clock::time_point;
+
         void submit(Task tsk) {
-            if (ind != BAD_INDEX) {
-                auto lg = std::lock_guard(queue[ind].m);
-                queue[ind].q.push_front(std::move(tsk));
+            submit(std::move(tsk), Priority::Normal);
+        }
+
+        /// @brief Submits `tsk` to the lane of `prio`.
+        /// A `deadline` only applies to High tasks: those run earliest deadline first after the other
+        /// High tasks of a worker, and once overdue they jump ahead of everything else it has queued.
+        void submit(Task tsk, Priority prio, Deadline deadline = Deadline::max()) {
+            auto t = TaskCell::make(std::move(tsk));
+            t->priority = prio;
+            if (opts.track_latency)
+                t->enqueued_ns = nowNs();
+
+            if (prio == Priority::High && deadline != Deadline::max())
+                t->deadline_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+
+            if (!enqueue(t)) {
+                TaskCell::recycle(t);
+                return;
             }
-            else {
-                int th = rand() % n_threads;
-                auto lg = std::lock_guard(queue[th].m);
-                queue[th].q.push_front(std::move(tsk));
+            wakeWorker();
+        }
+
+        /// @brief Submits every element of [first, last), moved into a `Task`, with one lock or one
+        /// deque fence per target queue instead of one per task. On a worker of this pool `OneQueue`
+        /// pushes straight into its own deque. Deadlines are not supported in bulk.
+        template <typename It>
+        void submitBulk(It first, It last, Priority prio = Priority::Normal, BulkSpread spread = BulkSpread::OneQueue) {
+            // reused between batches; nothing below submits in bulk again before it is cleared
+            static thread_local std::vector<TaskCell*> cells;
+            cells.clear();
+            int64_t enqueued_ns = opts.track_latency ? nowNs() : 0;
+            for (; first != last; ++first) {
+                auto t = TaskCell::make(Task(std::move(*first)));
+                t->priority = prio;
+                t->enqueued_ns = enqueued_ns;
+                cells.push_back(t);
+            }
+            if (cells.empty())
+                return;
+
+            if (spread == BulkSpread::AllQueues && cells.size() > 1 && n_threads > 1) {
+                // contiguous slices, the first one at a random worker so that small batches spread too
+                unsigned start = nextRandom() % n_threads;
+                unsigned slices = std::min<size_t>(n_threads, cells.size());
+                for (unsigned k = 0; k < slices; k++) {
+                    size_t begin = cells.size() * k / slices;
+                    size_t end = cells.size() * (k + 1) / slices;
+                    if (!post(queue[(start + k) % n_threads], cells.data() + begin, end - begin))
+                        dropCells(cells.data() + begin, end - begin);
+                }
+                cells.clear();
+                idle.notifyAll();
+                reactor.wake();
+                return;
+            }
+
+            if (local_pool == this) {
+                auto& wq = queue[ind];
+                wq.pushed.store(wq.pushed.load(std::memory_order_relaxed) + cells.size(), std::memory_order_relaxed);
+                wq.deques[unsigned(prio)].pushBulk(cells.data(), cells.size());
+            }
+            else if (!post(queue[nextRandom() % n_threads], cells.data(), cells.size())) {
+                dropCells(cells.data(), cells.size());
+                cells.clear();
+                return;
+            }
+            cells.clear();
+            wakeWorker();
+        }
+
+        /// @brief Submits `f(args...)` and returns the future of its result.
+        /// Callables and arguments are decay-copied into the task, exceptions end up in the future.
+        template <
+            typename F, typename... Args,
+            typename R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>
+        >
+        Future<R> submit(F&& f, Args&&... args) {
+            auto state = std::make_shared<FutureState<R>>(this);
+            submit(Task([promise = Promise<R>(state), f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                promise.run([&](){ return std::apply(f, std::move(args)); });
+            }));
+            return Future<R>(std::move(state));
+        }
+
+        /// @brief Awaitable that moves the awaiting coroutine onto this pool: it is resumed by a
+        /// worker as a task of priority `prio`. If a cancelling shutdown drops that task, the coroutine
+        /// is resumed right there and the `co_await` throws `TaskCancelled`. See coroutine.hpp.
+        auto schedule(Priority prio = Priority::Normal) {
+            struct Awaiter {
+                ThreadPool& pool;
+                Priority prio;
+                bool cancelled = false;
+
+                bool await_ready() const noexcept {
+                    return false;
+                }
+
+                void await_suspend(std::coroutine_handle<> h) {
+                    auto cancel = DropGuard([this, h](){
+                        cancelled = true;
+                        h.resume();
+                    });
+                    pool.submit(Task([h, cancel = std::move(cancel)]() mutable {
+                        cancel.disarm();
+                        h.resume();
+                    }), prio);
+                }
+
+                void await_resume() const {
+                    if (cancelled)
+                        throw TaskCancelled();
+                }
+            };
+            return Awaiter{*this, prio};
+        }
+
+        /// @brief Runs `callback(ready events)` as a task of this pool whenever `fd` is ready for
+        /// `events` (`EPOLLIN`, `EPOLLOUT`, ...), replacing an earlier callback of the same fd.
+        ///
+        /// Idle workers take turns polling: the first to run out of work sleeps in epoll_wait instead
+        /// of on the futex, and busy ones check every `IO_POLL_INTERVAL` tasks. Ready fds become tasks
+        /// in the polling worker's own deque, where the others can steal them. Callbacks of one fd never
+        /// run concurrently, so they can keep per-fd state without locks.
+        /// @warning Throws `std::system_error` if epoll refuses `fd`.
+        void watch(int fd, uint32_t events, Reactor::Callback callback) {
+            reactor.watch(fd, events, std::move(callback));
+            // every worker may be parked on the futex, which the reactor does not wake
+            wakeWorker();
+        }
+
+        /// Stops the callbacks of `fd`; one that is running finishes, queued ones are skipped.
+        void unwatch(int fd) {
+            reactor.unwatch(fd);
+        }
+
+        /// true on the worker threads of this pool
+        bool inPool() const {
+            return local_pool == this;
+        }
+
+        /// On a worker: whether its own deque is empty, i.e. whatever it pushed last has been
+        /// taken by thieves. This is the demand signal lazy splitting in parallel.hpp relies on.
+        bool localQueueEmpty() const {
+            return local_pool != this || queue[ind].dequesEmpty();
+        }
+
+        /// @brief On a worker of this pool: runs queued tasks until `pred()` holds, so waiting
+        /// for other tasks never blocks a worker. Does nothing and returns false on other threads.
+        template <typename Pred>
+        bool helpUntil(Pred pred) {
+            if (local_pool != this)
+                return false;
+            while (!pred()) {
+                if (!runOne())
+                    std::this_thread::yield();
             }
+            return true;
+        }
+
+        /// Time tasks of `prio` spent queued, over all workers; empty unless `track_latency` is set.
+        LatencyStats queueLatency(Priority prio) const {
+            std::vector<uint64_t> merged;
+            uint64_t max_ns = 0;
+            for (auto& wq : queue)
+                max_ns = std::max(max_ns, wq.latency[unsigned(prio)].mergeInto(merged));
+            return LatencyHistogram::summarize(merged, max_ns);
+        }
+
+        /// Successful steals of all workers so far, indexed by `StealLevel`.
+        /// Without `topology_aware` placement is unknown and every steal counts as `Remote`.
+        std::array<uint64_t, STEAL_LEVELS> stealsByLevel() const {
+            std::array<uint64_t, STEAL_LEVELS> total{};
+            for (auto& wq : queue) {
+                for (unsigned level = 0; level < STEAL_LEVELS; level++)
+                    total[level] += wq.steals[level].load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        /// @brief Counters of every worker, indexed by worker; all zero unless `collect_stats` is set,
+        /// except for `steals`, `errors` and `queued`. Counters are read while the workers keep going, so a
+        /// snapshot of a busy pool is only roughly consistent across fields.
+        std::vector<WorkerStats> stats() const {
+            std::vector<WorkerStats> all(n_threads);
+            for (unsigned i = 0; i < n_threads; i++) {
+                auto& wq = queue[i];
+                auto& c = wq.counters;
+                auto& s = all[i];
+                s.local_pops = c.local_pops.load(std::memory_order_relaxed);
+                for (auto& level : wq.steals)
+                    s.steals += level.load(std::memory_order_relaxed);
+                s.failed_steals = c.failed_steals.load(std::memory_order_relaxed);
+                s.idle_spins = c.idle_spins.load(std::memory_order_relaxed);
+                s.parks = c.parks.load(std::memory_order_relaxed);
+                s.tasks = c.tasks.load(std::memory_order_relaxed);
+                s.busy_ns = c.busy_ns.load(std::memory_order_relaxed);
+                s.errors = c.errors.load(std::memory_order_relaxed);
+                s.queued = wq.inbox_size.load(std::memory_order_relaxed);
+                for (auto& deque : wq.deques)
+                    s.queued += deque.size();
+            }
+            return all;
+        }
+
+        /// @brief Writes the recorded task runs as Chrome trace JSON (chrome://tracing, Perfetto),
+        /// one track per worker. Empty unless `trace_events` is set.
+        /// @warning Call only while the pool is idle, after `waitIdle` or `shutdown`.
+        void writeTrace(std::ostream& out) const;
+
+        /// Counts a task that threw in `WorkerStats::errors`. Futures, groups and parallel loops call it
+        /// when they catch an exception for their waiter; does nothing off the pool's workers.
+        void noteTaskError() {
+            if (local_pool == this)
+                WorkerCounters::bump(queue[ind].counters.errors);
         }
 
-        // each thread can obtain a pointer to the ThreadPool for submiting tasks 
+        // each worker can obtain a pointer to its ThreadPool for submiting tasks, nullptr elsewhere
         static ThreadPool* current() {
-            return self;
+            return local_pool;
         }
 };
\ No newline at end of file
@@ -1,6 +1,11 @@
 #include "thread_pool.hpp"
+#include "parallel.hpp"
+#include "coroutine.hpp"
+#include "task_group.hpp"
 #include <gtest/gtest.h>
 #include <sstream>
+#include <fcntl.h>
+#include <sys/epoll.h>
 TEST(ThreadPool, Unit1) {
     ThreadPool pool{2};
 
@@ -30,4 +35,592 @@ TEST(ThreadPool, Unit2) {
             }
         });
     }
-}
\ No newline at end of file
+}
+
+TEST(ChaseLevDeque, OwnerAndThieves) {
+    const int N = 100000;
+    ChaseLevDeque<int*> dq{4};
+    std::vector<int> values(N, 0);
+    std::vector<std::atomic<int>> taken(N);
+    std::atomic<bool> pushed = false;
+
+    std::vector<std::thread> thieves;
+    for (int k = 0; k < 3; k++) {
+        thieves.push_back(std::thread([&](){
+            int* p;
+            while (!pushed || !dq.empty()) {
+                if (dq.steal(p))
+                    taken[p - values.data()]++;
+            }
+        }));
+    }
+
+    int* p;
+    for (int i = 0; i < N; i++) {
+        dq.push(&values[i]);
+        if (i % 3 == 0 && dq.pop(p))
+            taken[p - values.data()]++;
+    }
+    while (dq.pop(p))
+        taken[p - values.data()]++;
+    pushed = true;
+
+    for (auto& th : thieves)
+        th.join();
+    for (int i = 0; i < N; i++)
+        EXPECT_EQ(taken[i], 1);
+}
+
+TEST(ThreadPool, WakesParkedWorkers) {
+    // park as soon as there is nothing to run
+    ThreadPoolOptions opts;
+    opts.spin_rounds = 0;
+    opts.yield_rounds = 0;
+    ThreadPool pool{4, opts};
+    std::atomic<int> executed = 0;
+
+    for (int round = 0; round < 3; round++) {
+        // give every worker time to fall asleep
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        for (int i = 0; i < 100; i++) {
+            pool.submit([&executed](){
+                executed++;
+            });
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (executed != (round + 1) * 100 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::yield();
+        ASSERT_EQ(executed, (round + 1) * 100);
+    }
+}
+
+TEST(ThreadPool, WaitIdleAndDrain) {
+    ThreadPool pool{4};
+    std::atomic<int> executed = 0;
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 100; i++) {
+            pool.submit(Task([&executed](){
+                // children are submitted while the parents still count as running
+                for (int k = 0; k < 3; k++)
+                    ThreadPool::current()->submit(Task([&executed](){ executed++; }));
+                executed++;
+            }));
+        }
+        pool.waitIdle();
+        EXPECT_EQ(executed, (round + 1) * 400);
+    }
+
+    // everything queued at shutdown still runs
+    for (int i = 0; i < 100; i++)
+        pool.submit(Task([&executed](){ executed++; }));
+    pool.shutdown(ShutdownMode::Drain);
+    EXPECT_EQ(executed, 1300);
+    pool.shutdown();
+    pool.waitIdle();
+}
+
+TEST(ThreadPool, ShutdownCancel) {
+    ThreadPool pool{1};
+    std::atomic<bool> release = false;
+    std::atomic<int> executed = 0;
+    // holds the only worker, unless the cancel comes first and drops it too
+    pool.submit(Task([&release](){
+        while (!release)
+            std::this_thread::yield();
+    }));
+    std::vector<Future<int>> results;
+    for (int i = 0; i < 50; i++)
+        results.push_back(pool.submit([&executed, i](){ executed++; return i; }));
+    auto chained = pool.submit([](){ return 1; }).then([](int v){ return v + 1; });
+    auto all = when_all(std::move(results));
+    std::vector<int> loop_hits(1000);
+    auto loop = pool.submit([&](){
+        parallel_for(*ThreadPool::current(), 0, 1000, 1, [&](int i){ loop_hits[i]++; });
+    });
+
+    std::thread releaser([&release](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release = true;
+    });
+    pool.shutdown(ShutdownMode::Cancel);
+    releaser.join();
+
+    EXPECT_EQ(executed, 0);
+    EXPECT_THROW(all.get(), TaskCancelled);
+    EXPECT_THROW(chained.get(), TaskCancelled);
+    EXPECT_THROW(loop.get(), TaskCancelled);
+    // a stopped pool drops new tasks right away
+    EXPECT_THROW(pool.submit([](){ return 0; }).get(), TaskCancelled);
+    pool.waitIdle();
+}
+
+TEST(ThreadPool, IndependentPools) {
+    ThreadPool a{2};
+    auto on_a = a.submit([](){ return ThreadPool::current(); });
+    EXPECT_EQ(on_a.get(), &a);
+    EXPECT_EQ(ThreadPool::current(), nullptr);
+    {
+        // tearing down another pool must not stop this one
+        ThreadPool b{2};
+        EXPECT_EQ(b.submit([](){ return ThreadPool::current(); }).get(), &b);
+    }
+    EXPECT_EQ(a.submit([](){ return 7; }).get(), 7);
+    EXPECT_THROW(a.submit([&a](){ a.waitIdle(); }).get(), std::logic_error);
+}
+
+TEST(ThreadPool, StatsAndTrace) {
+    ThreadPoolOptions opts;
+    opts.collect_stats = true;
+    opts.trace_events = 1000;
+    ThreadPool pool{2, opts};
+    for (int i = 0; i < 50; i++) {
+        pool.submit(Task([](){
+            ThreadPool::current()->submit(Task([](){
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }));
+        }));
+    }
+    pool.waitIdle();
+
+    WorkerStats total;
+    for (auto& s : pool.stats()) {
+        total.local_pops += s.local_pops;
+        total.steals += s.steals;
+        total.tasks += s.tasks;
+        total.busy_ns += s.busy_ns;
+        total.queued += s.queued;
+    }
+    EXPECT_EQ(total.tasks, 100);
+    EXPECT_EQ(total.local_pops + total.steals, 100);
+    EXPECT_GE(total.busy_ns, 50 * 100000);
+    EXPECT_EQ(total.queued, 0);
+
+    std::stringstream trace;
+    pool.writeTrace(trace);
+    auto json = trace.str();
+    size_t runs = 0;
+    for (auto pos = json.find("\"ph\":\"X\""); pos != std::string::npos; pos = json.find("\"ph\":\"X\"", pos + 1))
+        runs++;
+    EXPECT_EQ(runs, 100);
+    EXPECT_EQ(json.find("{\"displayTimeUnit\""), 0);
+}
+
+TEST(ThreadPool, ThrowingTasksKeepWorkers) {
+    std::atomic<int> reported = 0;
+    ThreadPoolOptions opts;
+    opts.on_error = [&reported](std::exception_ptr e){
+        EXPECT_THROW(std::rethrow_exception(e), std::runtime_error);
+        reported++;
+    };
+    ThreadPool pool{4, opts};
+    std::atomic<int> executed = 0;
+    std::vector<Future<int>> futures;
+    for (int i = 0; i < 1000; i++) {
+        if (i % 10 == 0) {
+            pool.submit(Task([](){ throw std::runtime_error("bad request"); }));
+            futures.push_back(pool.submit([]() -> int { throw std::runtime_error("bad future"); }));
+        }
+        else
+            pool.submit(Task([&executed](){ executed++; }));
+    }
+    for (auto& f : futures)
+        EXPECT_THROW(f.get(), std::runtime_error);
+    pool.waitIdle();
+
+    EXPECT_EQ(executed, 900);
+    EXPECT_EQ(reported, 100);
+    uint64_t errors = 0;
+    for (auto& s : pool.stats())
+        errors += s.errors;
+    EXPECT_EQ(errors, 200);
+    pool.shutdown();
+}
+
+TEST(ThreadPool, SubmitBulk) {
+    ThreadPool pool{4};
+    std::atomic<int> executed = 0;
+    auto batch = [&executed](size_t n){
+        std::vector<Task> tasks;
+        for (size_t i = 0; i < n; i++)
+            tasks.emplace_back([&executed](){ executed++; });
+        return tasks;
+    };
+
+    auto external = batch(1000);
+    pool.submitBulk(external.begin(), external.end());
+    auto spread = batch(1000);
+    pool.submitBulk(spread.begin(), spread.end(), Priority::High, BulkSpread::AllQueues);
+    // from a worker, past the initial deque capacity
+    pool.submit(Task([&](){
+        auto local = batch(1000);
+        ThreadPool::current()->submitBulk(local.begin(), local.end());
+    }));
+    pool.waitIdle();
+    EXPECT_EQ(executed, 3000);
+    EXPECT_FALSE(external[0]);
+
+    pool.shutdown();
+    auto late = batch(10);
+    pool.submitBulk(late.begin(), late.end(), Priority::Normal, BulkSpread::AllQueues);
+    EXPECT_EQ(executed, 3000);
+}
+
+TEST(ThreadPool, ReactorCallbacks) {
+    ThreadPool pool{3};
+    const int PIPES = 8;
+    int fds[PIPES][2];
+    std::atomic<int> received = 0;
+    std::atomic<int> overlapping = 0;
+    std::vector<std::atomic<int>> inside(PIPES);
+    for (int i = 0; i < PIPES; i++) {
+        ASSERT_EQ(pipe2(fds[i], O_NONBLOCK), 0);
+        pool.watch(fds[i][0], EPOLLIN, [&, i](uint32_t events){
+            EXPECT_TRUE(events & EPOLLIN);
+            if (inside[i]++ != 0)
+                overlapping++;
+            char buff[64];
+            ssize_t n;
+            while ((n = read(fds[i][0], buff, sizeof(buff))) > 0)
+                received += n;
+            inside[i]--;
+        });
+    }
+    // long tasks keep the workers busy, the fds still get polled in between
+    for (int i = 0; i < 20; i++)
+        pool.submit(Task([](){ std::this_thread::sleep_for(std::chrono::milliseconds(1)); }));
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < PIPES; i++)
+            ASSERT_EQ(write(fds[i][1], "x", 1), 1);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (received != 100 * PIPES && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+    EXPECT_EQ(received, 100 * PIPES);
+    EXPECT_EQ(overlapping, 0);
+
+    for (int i = 0; i < PIPES; i++) {
+        pool.unwatch(fds[i][0]);
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+}
+
+TEST(Future, GetAndArguments) {
+    ThreadPool pool{4};
+
+    auto sum = pool.submit([](int a, int b){ return a + b; }, 2, 3);
+    auto str = pool.submit([](std::string s){ return s + "!"; }, std::string("ok"));
+    auto nothing = pool.submit([](){});
+
+    EXPECT_EQ(sum.get(), 5);
+    EXPECT_EQ(str.get(), "ok!");
+    nothing.get();
+    EXPECT_FALSE(sum.valid());
+}
+
+TEST(Future, ThenChain) {
+    ThreadPool pool{4};
+
+    auto f = pool.submit([](){ return 1; })
+        .then([](int x){ return x * 10; })
+        .then([](int x){ return std::to_string(x); });
+    EXPECT_EQ(f.get(), "10");
+
+    std::atomic<bool> after_void = false;
+    pool.submit([](){}).then([&after_void](){ after_void = true; }).get();
+    EXPECT_TRUE(after_void);
+}
+
+TEST(Future, ExceptionSkipsContinuation) {
+    ThreadPool pool{2};
+
+    std::atomic<bool> called = false;
+    auto f = pool.submit([]() -> int { throw std::runtime_error("bad task"); })
+        .then([&called](int x){ called = true; return x; });
+    EXPECT_THROW(f.get(), std::runtime_error);
+    EXPECT_FALSE(called);
+}
+
+TEST(Future, WhenAll) {
+    ThreadPool pool{4};
+
+    std::vector<Future<int>> parts;
+    for (int i = 0; i < 100; i++)
+        parts.push_back(pool.submit([i](){ return i * i; }));
+    auto all = when_all(std::move(parts)).then([](std::vector<int> squares){
+        int sum = 0;
+        for (auto s : squares)
+            sum += s;
+        return sum;
+    });
+    EXPECT_EQ(all.get(), 328350);
+
+    std::atomic<int> counter = 0;
+    std::vector<Future<void>> voids;
+    for (int i = 0; i < 10; i++)
+        voids.push_back(pool.submit([&counter](){ counter++; }));
+    when_all(std::move(voids)).get();
+    EXPECT_EQ(counter, 10);
+
+    EXPECT_TRUE(when_all(std::vector<Future<int>>{}).get().empty());
+}
+
+TEST(Future, WaitInsideWorkerHelps) {
+    // a single worker waiting for its own subtask would deadlock if it blocked
+    ThreadPool pool{1};
+
+    auto outer = pool.submit([](){
+        auto inner = ThreadPool::current()->submit([](){ return 7; });
+        return inner.get() + 1;
+    });
+    EXPECT_EQ(outer.get(), 8);
+}
+
+TEST(UniqueTask, MoveOnlyAndHeapFallback) {
+    int calls = 0;
+    auto owned = std::make_unique<int>(5);
+    Task small([&calls, p = std::move(owned)](){ calls += *p; });
+
+    Task moved = std::move(small);
+    EXPECT_FALSE(small);
+    moved();
+    EXPECT_EQ(calls, 5);
+
+    struct Big {
+        char bytes[2 * TASK_INLINE_SIZE];
+    };
+    static_assert(!Task::storedInline<Big>());
+    auto counter = std::make_shared<int>(0);
+    Task big([counter, b = Big{}](){ (*counter) += 1 + b.bytes[0]; });
+    Task big_moved;
+    big_moved = std::move(big);
+    big_moved();
+    EXPECT_EQ(*counter, 1);
+    EXPECT_EQ(counter.use_count(), 2);
+    big_moved.reset();
+    EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(UniqueTask, MoveOnlyCaptureThroughPool) {
+    ThreadPool pool{2};
+
+    auto answer = std::make_unique<int>(42);
+    auto f = pool.submit([p = std::move(answer)](){ return *p; });
+    EXPECT_EQ(f.get(), 42);
+}
+
+TEST(Topology, DetectAndStealOrder) {
+    auto topo = CpuTopology::detect();
+    ASSERT_FALSE(topo.cpus.empty());
+    for (auto& c : topo.cpus)
+        EXPECT_EQ(CpuTopology::level(c, c), StealLevel::Smt);
+
+    ThreadPoolOptions opts;
+    opts.topology_aware = true;
+    ThreadPool pool{4, opts};
+    std::vector<Future<int>> parts;
+    for (int i = 0; i < 1000; i++)
+        parts.push_back(pool.submit([i](){ return i % 2; }));
+    int odd = 0;
+    for (auto v : when_all(std::move(parts)).get())
+        odd += v;
+    EXPECT_EQ(odd, 500);
+}
+
+TEST(Parallel, ForCoversRangeOnce) {
+    ThreadPool pool{4};
+    std::vector<std::atomic<int>> hits(10007);
+
+    parallel_for(pool, 0, 10007, 16, [&hits](int i){ hits[i]++; });
+    for (auto& h : hits)
+        ASSERT_EQ(h, 1);
+
+    parallel_for(pool, 5, 5, 1, [&hits](int i){ hits[i]++; });
+
+    // nested inside a task, the first piece runs on the calling worker
+    pool.submit([&pool, &hits](){
+        parallel_for(pool, 0, 10007, 1, [&hits](int i){ hits[i]++; });
+    }).get();
+    for (auto& h : hits)
+        ASSERT_EQ(h, 2);
+}
+
+TEST(Parallel, ReduceAndExceptions) {
+    ThreadPool pool{4};
+
+    auto sum = parallel_reduce(pool, int64_t(1), int64_t(100001), int64_t(128), int64_t(0),
+        [](int64_t i){ return i; },
+        [](int64_t a, int64_t b){ return a + b; });
+    EXPECT_EQ(sum, int64_t(5000050000));
+
+    EXPECT_THROW(parallel_for(pool, 0, 1000, 1, [](int i){
+        if (i == 500)
+            throw std::out_of_range("500");
+    }), std::out_of_range);
+}
+
+TEST(Priority, HighRunsBeforeNormal) {
+    ThreadPoolOptions opts;
+    opts.track_latency = true;
+    ThreadPool pool{1, opts};
+    std::mutex order_m;
+    std::vector<int> order;
+    auto record = [&](int v){
+        return [&, v](){
+            auto lg = std::lock_guard(order_m);
+            order.push_back(v);
+        };
+    };
+
+    // the single worker is held by the first task while the rest queue up behind it
+    std::atomic<bool> release = false;
+    pool.submit([&release](){
+        while (!release)
+            std::this_thread::yield();
+    }).then([&](){
+        auto pool = ThreadPool::current();
+        for (int i = 0; i < 3; i++)
+            pool->submit(Task(record(0)), Priority::Normal);
+        auto now = std::chrono::steady_clock::now();
+        pool->submit(Task(record(3)), Priority::High, now + std::chrono::hours(2));
+        pool->submit(Task(record(2)), Priority::High, now + std::chrono::hours(1));
+        pool->submit(Task(record(1)), Priority::High);
+        pool->submit(Task(record(4)), Priority::High, now - std::chrono::seconds(1));
+    });
+    release = true;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        auto lg = std::lock_guard(order_m);
+        if (order.size() == 7)
+            break;
+    }
+    // overdue first, then plain High, then High by deadline, then Normal
+    EXPECT_EQ(order, (std::vector<int>{4, 1, 2, 3, 0, 0, 0}));
+    EXPECT_EQ(pool.queueLatency(Priority::High).count, 4);
+    EXPECT_GE(pool.queueLatency(Priority::Normal).count, 3);
+}
+
+TEST(LatencyHistogram, Percentiles) {
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 1000; v++)
+        h.record(v * 1000);
+    std::vector<uint64_t> merged;
+    auto stats = LatencyHistogram::summarize(merged, h.mergeInto(merged));
+    EXPECT_EQ(stats.count, 1000);
+    EXPECT_EQ(stats.max_ns, 1000000);
+    EXPECT_GE(stats.p50_ns, 500000);
+    EXPECT_LE(stats.p50_ns, 500000 * 1.125);
+    EXPECT_GE(stats.p99_ns, 990000);
+    EXPECT_LE(stats.p99_ns, 1000000);
+}
+
+static CoTask<int> coFib(ThreadPool& pool, int n) {
+    if (n < 2)
+        co_return n;
+    auto a = spawn(pool, coFib(pool, n - 1));
+    auto b = co_await coFib(pool, n - 2);
+    co_return co_await a + b;
+}
+
+TEST(Coroutine, SpawnAndAwait) {
+    ThreadPool pool{4};
+    EXPECT_EQ(launch(pool, coFib(pool, 20)).get(), 6765);
+
+    // thousands of suspended coroutines multiplexed over two workers
+    auto hop = [](ThreadPool& pool, std::atomic<int>& resumed) -> CoTask<> {
+        co_await pool.schedule();
+        EXPECT_EQ(ThreadPool::current(), &pool);
+        resumed++;
+    };
+    auto fanOut = [&hop](ThreadPool& pool, std::atomic<int>& resumed) -> CoTask<> {
+        std::vector<CoTask<>> children;
+        for (int i = 0; i < 5000; i++)
+            children.push_back(spawn(pool, hop(pool, resumed)));
+        for (auto& c : children)
+            co_await c;
+    };
+    std::atomic<int> resumed = 0;
+    launch(pool, fanOut(pool, resumed)).get();
+    EXPECT_EQ(resumed, 5000);
+}
+
+TEST(Coroutine, ExceptionsAndCancel) {
+    ThreadPool pool{2};
+    auto failing = []() -> CoTask<int> {
+        throw std::runtime_error("boom");
+        co_return 0;
+    };
+    auto outer = [&failing](ThreadPool& pool) -> CoTask<int> {
+        try {
+            co_return co_await spawn(pool, failing());
+        }
+        catch (std::runtime_error&) {
+            co_return -1;
+        }
+    };
+    EXPECT_EQ(launch(pool, outer(pool)).get(), -1);
+    EXPECT_THROW(launch(pool, failing()).get(), std::runtime_error);
+
+    pool.shutdown();
+    // resuming on a stopped pool fails the coroutine instead of losing it
+    EXPECT_THROW(launch(pool, coFib(pool, 5)).get(), TaskCancelled);
+}
+
+static void groupTree(TaskGroup& group, int depth, std::atomic<int>& nodes) {
+    nodes++;
+    if (depth == 0)
+        return;
+    for (int k = 0; k < 3; k++)
+        group.spawn([&group, depth, &nodes](){ groupTree(group, depth - 1, nodes); });
+}
+
+static int groupFib(ThreadPool& pool, int n) {
+    if (n < 2)
+        return n;
+    int a = 0, b = 0;
+    TaskGroup group(pool);
+    group.spawn([&](){ a = groupFib(pool, n - 1); });
+    b = groupFib(pool, n - 2);
+    group.wait();
+    return a + b;
+}
+
+TEST(TaskGroup, WaitCoversSubtree) {
+    ThreadPool pool{4};
+    std::atomic<int> nodes = 0;
+    TaskGroup group(pool);
+    group.spawn([&](){ groupTree(group, 6, nodes); });
+    group.wait();
+    // 1 + 3 + ... + 3^6
+    EXPECT_EQ(nodes, 1093);
+
+    // nested groups waiting on two workers only ever help, they never block
+    ThreadPool small{2};
+    EXPECT_EQ(small.submit(groupFib, std::ref(small), 18).get(), 2584);
+}
+
+TEST(TaskGroup, CancelAndExceptions) {
+    ThreadPool pool{1};
+    std::atomic<bool> release = false;
+    std::atomic<int> ran = 0;
+    TaskGroup group(pool);
+    group.spawn([&](){
+        while (!release)
+            std::this_thread::yield();
+    });
+    for (int i = 0; i < 100; i++)
+        group.spawn([&](){ ran++; });
+    group.cancel();
+    release = true;
+    group.wait();
+    EXPECT_EQ(ran, 0);
+    group.spawn([&](){ ran++; });
+    group.wait();
+    EXPECT_EQ(ran, 0);
+
+    group.reset();
+    group.spawn([](){ throw std::runtime_error("boom"); });
+    EXPECT_THROW(group.wait(), std::runtime_error);
+    EXPECT_TRUE(group.cancelled());
+}
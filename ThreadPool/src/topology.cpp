@@ -0,0 +1,127 @@
+#include "topology.hpp"
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <sched.h>
+#include <string>
+#include <thread>
+#include <tuple>
+
+static const std::string SYSFS_CPU = "/sys/devices/system/cpu/";
+
+static std::string readLine(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+static int readInt(const std::string& path, int fallback) {
+    auto line = readLine(path);
+    try {
+        return line.empty() ? fallback : std::stoi(line);
+    }
+    catch (...) {
+        return fallback;
+    }
+}
+
+// parses sysfs cpu lists like "0-3,8,10-11"
+static std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        auto comma = list.find(',', pos);
+        if (comma == std::string::npos)
+            comma = list.size();
+        auto range = list.substr(pos, comma - pos);
+        auto dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int c = first; c <= last; c++)
+                cpus.push_back(c);
+        }
+        catch (...) {}
+        pos = comma + 1;
+    }
+    return cpus;
+}
+
+static int smallestOf(const std::string& list_path, int fallback) {
+    auto cpus = parseCpuList(readLine(list_path));
+    return cpus.empty() ? fallback : *std::min_element(cpus.begin(), cpus.end());
+}
+
+static int lastLevelCache(const std::string& base) {
+    for (int index = 0; ; index++) {
+        auto dir = base + "/cache/index" + std::to_string(index);
+        auto level = readInt(dir + "/level", -1);
+        if (level == -1)
+            return -1;
+        if (level == 3)
+            return smallestOf(dir + "/shared_cpu_list", -1);
+    }
+}
+
+// the cpuN directory links to the node it belongs to as "nodeM"
+static int numaNode(const std::string& base) {
+    auto dir = opendir(base.c_str());
+    if (!dir)
+        return 0;
+    int node = 0;
+    while (auto entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0) {
+            try {
+                node = std::stoi(name.substr(4));
+            }
+            catch (...) {}
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+CpuTopology CpuTopology::detect() {
+    CpuTopology topo;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool have_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    for (auto cpu : parseCpuList(readLine(SYSFS_CPU + "online"))) {
+        if (have_mask && !CPU_ISSET(cpu, &allowed))
+            continue;
+        auto base = SYSFS_CPU + "cpu" + std::to_string(cpu);
+        topo.cpus.push_back(CpuInfo{
+            cpu,
+            smallestOf(base + "/topology/thread_siblings_list", cpu),
+            lastLevelCache(base),
+            numaNode(base),
+            readInt(base + "/topology/physical_package_id", 0)
+        });
+    }
+
+    if (topo.cpus.empty()) {
+        unsigned n = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < n; cpu++)
+            topo.cpus.push_back(CpuInfo{int(cpu), int(cpu), -1, 0, 0});
+    }
+
+    std::sort(topo.cpus.begin(), topo.cpus.end(), [](const CpuInfo& a, const CpuInfo& b){
+        return std::tie(a.node, a.package, a.l3, a.core, a.cpu) < std::tie(b.node, b.package, b.l3, b.core, b.cpu);
+    });
+    return topo;
+}
+
+StealLevel CpuTopology::level(const CpuInfo& a, const CpuInfo& b) {
+    if (a.core == b.core)
+        return StealLevel::Smt;
+    if (a.l3 != -1 && a.l3 == b.l3)
+        return StealLevel::Cache;
+    if (a.node == b.node)
+        return StealLevel::Node;
+    return StealLevel::Remote;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+/// How close a victim's CPU is to the thief's, in the order workers look for work to steal.
+enum class StealLevel : unsigned {
+    Smt = 0,    // the same physical core
+    Cache,      // the same last level cache
+    Node,       // the same NUMA node
+    Remote      // another node, or placement unknown
+};
+
+constexpr unsigned STEAL_LEVELS = 4;
+
+struct CpuInfo {
+    int cpu;
+    int core;       // smallest cpu among the SMT siblings, unique per physical core
+    int l3;         // smallest cpu sharing the L3 cache, -1 if sysfs does not tell
+    int node;       // NUMA node, 0 on machines without NUMA
+    int package;
+};
+
+/// CPUs this process may run on, as described by /sys/devices/system/cpu.
+class CpuTopology {
+    public:
+        /// In compact order: grouped by NUMA node, then L3, then physical core, so that
+        /// workers placed on consecutive entries share as much of the hierarchy as possible.
+        std::vector<CpuInfo> cpus;
+
+        /// Never empty: without sysfs it falls back to `hardware_concurrency()` unrelated CPUs.
+        static CpuTopology detect();
+
+        static StealLevel level(const CpuInfo& a, const CpuInfo& b);
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "task.hpp"
+
+/// Scheduler counters of one worker, as returned by `ThreadPool::stats()`.
+struct WorkerStats {
+    // tasks taken from its own deques and inbox
+    uint64_t local_pops = 0;
+    uint64_t steals = 0;
+    // rounds over every victim that found nothing
+    uint64_t failed_steals = 0;
+    // `pause` and `yield` rounds while out of work
+    uint64_t idle_spins = 0;
+    uint64_t parks = 0;
+    uint64_t tasks = 0;
+    // time spent running tasks; a task that helps while it waits includes the tasks it ran
+    uint64_t busy_ns = 0;
+    // tasks that threw, whether the exception went to a waiter or to `ThreadPoolOptions::on_error`
+    uint64_t errors = 0;
+    // tasks waiting in its deques and inbox when the snapshot was taken
+    uint64_t queued = 0;
+};
+
+/// @brief Live counters behind `WorkerStats`, a cache line block of its own per worker.
+/// Only the owning worker writes, so a bump is a relaxed load and store rather than a locked add.
+struct alignas(64) WorkerCounters {
+    std::atomic<uint64_t> local_pops{0};
+    std::atomic<uint64_t> failed_steals{0};
+    std::atomic<uint64_t> idle_spins{0};
+    std::atomic<uint64_t> parks{0};
+    std::atomic<uint64_t> tasks{0};
+    std::atomic<uint64_t> busy_ns{0};
+    std::atomic<uint64_t> errors{0};
+
+    static void bump(std::atomic<uint64_t>& c, uint64_t by = 1) {
+        c.store(c.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+};
+
+/// One task run for the Chrome trace written by `ThreadPool::writeTrace`.
+struct TraceEvent {
+    int64_t begin_ns;
+    int64_t end_ns;
+    Priority priority;
+};